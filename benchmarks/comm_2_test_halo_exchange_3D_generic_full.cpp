@@ -26,6 +26,9 @@
 #include <ghex/structured/simple_field_wrapper.hpp>
 #include <ghex/transport_layer/mpi/communicator.hpp>
 #include <ghex/common/timer.hpp>
+#ifdef GHEX_BENCHMARKS_USE_MULTI_THREADED_MPI
+#include <ghex/common/thread_pool.hpp>
+#endif
 
 #include <gridtools/common/array.hpp>
 #ifdef __CUDACC__
@@ -159,6 +162,14 @@ namespace halo_exchange_3D_generic_full {
 #endif
         // communication object
         auto co = gridtools::ghex::make_communication_object<decltype(pattern_1)>();
+#ifdef GHEX_BENCHMARKS_USE_MULTI_THREADED_MPI
+        // one communication object per field, each driven by its own thread and using its own tag range
+        auto co_1 = gridtools::ghex::make_communication_object<decltype(pattern_1)>(gridtools::ghex::auto_id, pattern_1[0].communicator());
+        auto co_2 = gridtools::ghex::make_communication_object<decltype(pattern_1)>(gridtools::ghex::auto_id, pattern_1[0].communicator());
+        auto co_3 = gridtools::ghex::make_communication_object<decltype(pattern_1)>(gridtools::ghex::auto_id, pattern_1[0].communicator());
+        // the threads are started once, outside of the timed loops
+        gridtools::ghex::thread_pool pool(3);
+#endif
 
 
         file << "Proc: (" << coords[0] << ", " << coords[1] << ", " << coords[2] << ")\n";
@@ -281,6 +292,22 @@ namespace halo_exchange_3D_generic_full {
                 timer_type t_1;
                 world.barrier();
                 t_0.tic();
+#ifdef GHEX_BENCHMARKS_USE_MULTI_THREADED_MPI
+                auto f_1 = pool.submit([&](){ co_1.bexchange(pattern_1(field1)); });
+#ifndef GHEX_1_PATTERN_BENCHMARK
+                auto f_2 = pool.submit([&](){ co_2.bexchange(pattern_2(field2)); });
+                auto f_3 = pool.submit([&](){ co_3.bexchange(pattern_3(field3)); });
+#else
+                auto f_2 = pool.submit([&](){ co_2.bexchange(pattern_1(field2)); });
+                auto f_3 = pool.submit([&](){ co_3.bexchange(pattern_1(field3)); });
+#endif
+                t_0.toc();
+                t_1.tic();
+                f_1.get();
+                f_2.get();
+                f_3.get();
+                t_1.toc();
+#else
                 auto h = co.exchange(
 #ifndef GHEX_1_PATTERN_BENCHMARK
                     pattern_1(field1),
@@ -295,6 +322,7 @@ namespace halo_exchange_3D_generic_full {
                 t_1.tic();
                 h.wait();
                 t_1.toc();
+#endif
                 world.barrier();
 
                 timer_type t;
@@ -425,6 +453,22 @@ namespace halo_exchange_3D_generic_full {
                 timer_type t_1;
                 world.barrier();
                 t_0.tic();
+#ifdef GHEX_BENCHMARKS_USE_MULTI_THREADED_MPI
+                auto f_1 = pool.submit([&](){ co_1.bexchange(pattern_1(field1)); });
+#ifndef GHEX_1_PATTERN_BENCHMARK
+                auto f_2 = pool.submit([&](){ co_2.bexchange(pattern_2(field2)); });
+                auto f_3 = pool.submit([&](){ co_3.bexchange(pattern_3(field3)); });
+#else
+                auto f_2 = pool.submit([&](){ co_2.bexchange(pattern_1(field2)); });
+                auto f_3 = pool.submit([&](){ co_3.bexchange(pattern_1(field3)); });
+#endif
+                t_0.toc();
+                t_1.tic();
+                f_1.get();
+                f_2.get();
+                f_3.get();
+                t_1.toc();
+#else
                 auto h = co.exchange(
 #ifndef GHEX_1_PATTERN_BENCHMARK
                     pattern_1(field1),
@@ -439,6 +483,7 @@ namespace halo_exchange_3D_generic_full {
                 t_1.tic();
                 h.wait();
                 t_1.toc();
+#endif
                 world.barrier();
 
                 timer_type t;
@@ -12,6 +12,8 @@
 #define INCLUDED_GHEX_BUFFER_INFO_HPP
 
 #include <vector>
+#include <cstddef>
+#include <utility>
 #include "./arch_traits.hpp"
 
 namespace gridtools {
@@ -53,7 +55,7 @@ namespace gridtools {
             :   m_p{&p}, m_field{&field}, m_id{id} { }
 
         public: // copy and move ctors
-            buffer_info(const buffer_info&) noexcept = default;
+            buffer_info(const buffer_info&) = default;
             buffer_info(buffer_info&&) noexcept = default;
 
         public: // member functions
@@ -62,10 +64,61 @@ namespace gridtools {
             const pattern_container_type& get_pattern_container() const noexcept { return m_p->container(); }
             field_type& get_field() noexcept { return *m_field; }
 
+            /** @brief request that the halos of this field are sent from and received into field memory using
+              * derived datatypes instead of being packed into buffers. All communicating ranks must make the same
+              * choice for a field. Only supported for cpu fields which can describe their memory layout.
+              * @param flag true selects derived datatypes, false selects packing (default)
+              * @return reference to this buffer_info */
+            buffer_info& use_datatype(bool flag = true) noexcept { m_use_datatype = flag; return *this; }
+            /** @return whether derived datatypes are used for this field */
+            bool uses_datatype() const noexcept { return m_use_datatype; }
+
+            /** @brief exchange only a number of halo layers of this field, which are obtained by clipping the
+              * pattern's halos (structured grids). All communicating ranks must use the same depth for a field.
+              * @param depth number of layers per direction (dim0_dir-, dim0_dir+, dim1_dir-, dim1_dir+, ...);
+              * an empty list selects the full halos of the pattern (default)
+              * @return reference to this buffer_info */
+            buffer_info& halo_depth(std::vector<int> depth) { m_halo_depth = std::move(depth); return *this; }
+            /** @return number of layers per direction exchanged for this field (empty: full halos) */
+            const std::vector<int>& halo_depth() const noexcept { return m_halo_depth; }
+
+            /** @brief exchange only the halos of a subset of the neighbor directions of this field (structured 
+              * grids, see structured/directions.hpp). Messages which become empty are skipped entirely. All 
+              * communicating ranks must use the same mask for a field.
+              * @param mask direction mask; an empty mask selects all directions (default)
+              * @return reference to this buffer_info */
+            buffer_info& halo_directions(std::vector<bool> mask) { m_halo_directions = std::move(mask); return *this; }
+            /** @return direction mask of this field (empty: all directions) */
+            const std::vector<bool>& halo_directions() const noexcept { return m_halo_directions; }
+
+            /** @brief attach a version to this field, which is incremented by the user whenever the field is 
+              * modified. Exchanges through a communication object skip the field (no packing, no messages) if
+              * an exchange of it with the same pattern, halo depth, direction mask and version has completed 
+              * (been waited for) before. Fields are identified by their id if they have one (see 
+              * structured::simple_field_wrapper::id) and by their memory otherwise. All communicating ranks must 
+              * attach versions to the same fields and use the same version for a field, i.e. the field must be 
+              * modified collectively, and must not start another exchange of the field before the previous one has
+              * completed. Exchanges with versioned fields check collectively that all ranks skip the same fields,
+              * and throw on all ranks otherwise. Exchanging the field without a version discards its recorded 
+              * versions (see also communication_object::reset_versions). Plans and reverse exchanges ignore the 
+              * version.
+              * @param v version of the field
+              * @return reference to this buffer_info */
+            buffer_info& version(std::size_t v) noexcept { m_version = v; m_versioned = true; return *this; }
+            /** @return whether a version is attached to this field */
+            bool versioned() const noexcept { return m_versioned; }
+            /** @return version of this field */
+            std::size_t version() const noexcept { return m_version; }
+
         private: // members
             const pattern_type* m_p;
             field_type* m_field;
             device_id_type m_id;
+            bool m_use_datatype = false;
+            std::vector<int> m_halo_depth;
+            std::vector<bool> m_halo_directions;
+            bool m_versioned = false;
+            std::size_t m_version = 0u;
         };
 
     } // namespace ghex
@@ -12,6 +12,7 @@
 #define INCLUDED_GHEX_COMMON_AWAIT_FUTURES_HPP
 
 #include <vector>
+#include <utility>
 
 namespace gridtools {
 
@@ -43,6 +44,51 @@ namespace gridtools {
             }
         }
 
+        /** @brief test all futures in a range once without blocking, call a continuation with the value of
+          * each ready future as argument and remove the ready futures from the range.
+          * @return true if no futures are left in the range */
+        template<typename FutureRange, typename Continuation>
+        bool progress_futures(FutureRange& range, Continuation&& cont)
+        {
+            std::size_t k = 0u;
+            while (k < range.size())
+            {
+                if (range[k].test())
+                {
+                    cont(range[k].get());
+                    if (k+1 < range.size())
+                        range[k] = std::move(range.back());
+                    range.pop_back();
+                }
+                else
+                    ++k;
+            }
+            return range.empty();
+        }
+
+        /** @brief move the futures whose value satisfies a predicate out of a range, without waiting for them.
+          * The order of the remaining futures is not preserved.
+          * @return selected futures */
+        template<typename FutureRange, typename Predicate>
+        FutureRange extract_futures(FutureRange& range, Predicate&& pred)
+        {
+            FutureRange selected;
+            std::size_t k = 0u;
+            while (k < range.size())
+            {
+                if (pred(range[k].peek()))
+                {
+                    selected.push_back(std::move(range[k]));
+                    if (k+1 < range.size())
+                        range[k] = std::move(range.back());
+                    range.pop_back();
+                }
+                else
+                    ++k;
+            }
+            return selected;
+        }
+
     } // namespace ghex
 
 } // namespace gridtools
@@ -0,0 +1,120 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2019, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef INCLUDED_GHEX_COMMON_THREAD_POOL_HPP
+#define INCLUDED_GHEX_COMMON_THREAD_POOL_HPP
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <chrono>
+
+namespace gridtools {
+
+    namespace ghex {
+
+        /** @brief a simple fixed-size pool of worker threads which execute submitted tasks in FIFO order. Used as
+          * an executor for packing and unpacking. The pool is neither copyable nor movable. */
+        class thread_pool
+        {
+        private: // members
+
+            std::vector<std::thread> m_threads;
+            std::queue<std::packaged_task<void()>> m_tasks;
+            std::mutex m_mutex;
+            std::condition_variable m_cv;
+            bool m_stop = false;
+
+        public: // ctors
+
+            /** @brief construct a pool and start the worker threads
+              * @param num_threads number of worker threads (at least 1) */
+            thread_pool(std::size_t num_threads = std::thread::hardware_concurrency())
+            {
+                if (num_threads == 0u) num_threads = 1u;
+                m_threads.reserve(num_threads);
+                for (std::size_t i=0; i<num_threads; ++i)
+                    m_threads.emplace_back([this](){ this->work(); });
+            }
+
+            thread_pool(const thread_pool&) = delete;
+            thread_pool(thread_pool&&) = delete;
+            thread_pool& operator=(const thread_pool&) = delete;
+            thread_pool& operator=(thread_pool&&) = delete;
+
+            /** @brief finishes all submitted tasks and joins the worker threads */
+            ~thread_pool()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_stop = true;
+                }
+                m_cv.notify_all();
+                for (auto& t : m_threads)
+                    t.join();
+            }
+
+        public: // member functions
+
+            /** @return number of worker threads */
+            std::size_t size() const noexcept { return m_threads.size(); }
+
+            /** @brief submit a task for asynchronous execution
+              * @tparam Func function type with signature void()
+              * @param f function object
+              * @return future which becomes ready when the task has been executed */
+            template<typename Func>
+            std::future<void> submit(Func&& f)
+            {
+                std::packaged_task<void()> task(std::forward<Func>(f));
+                auto fut = task.get_future();
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_tasks.push(std::move(task));
+                }
+                m_cv.notify_one();
+                return fut;
+            }
+
+            /** @brief test whether the task belonging to a future has been executed (non-blocking)
+              * @param fut future returned by submit
+              * @return true if ready */
+            static bool ready(const std::future<void>& fut)
+            {
+                return fut.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+            }
+
+        private: // implementation
+
+            void work()
+            {
+                while (true)
+                {
+                    std::packaged_task<void()> task;
+                    {
+                        std::unique_lock<std::mutex> lock(m_mutex);
+                        m_cv.wait(lock, [this](){ return m_stop || !m_tasks.empty(); });
+                        if (m_tasks.empty()) return;
+                        task = std::move(m_tasks.front());
+                        m_tasks.pop();
+                    }
+                    task();
+                }
+            }
+        };
+
+    } // namespace ghex
+
+} // namespace gridtools
+
+#endif /* INCLUDED_GHEX_COMMON_THREAD_POOL_HPP */
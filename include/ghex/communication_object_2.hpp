@@ -15,24 +15,157 @@
 #include "./packer.hpp"
 #include "./common/utils.hpp"
 #include "./common/test_eq.hpp"
+#include "./common/thread_pool.hpp"
 #include "./buffer_info.hpp"
+#include "./exchange_plan.hpp"
 #include "./transport_layer/communicator.hpp"
+#include "./transport_layer/mpi/node_topology.hpp"
+#include "./transport_layer/mpi/tag_slot.hpp"
 #include "./structured/simple_field_wrapper.hpp"
+#include "./structured/datatype.hpp"
 #include "./arch_traits.hpp"
 #include <map>
+#include <array>
+#include <memory>
 #include <stdio.h>
+#include <cstring>
+#include <cstdint>
 #include <functional>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <algorithm>
 
 namespace gridtools {
 
     namespace ghex {
 
-        // forward declaration
-        template<typename Transport, typename GridType, typename DomainIdType>
-        class communication_object;
+        namespace detail {
+            // pointer to the halo region in field memory if the field can tell that it is contiguous
+            template<typename Field, typename IndexContainer>
+            auto contiguous_data(Field* field_ptr, const IndexContainer& c, int) -> decltype((void*)field_ptr->contiguous_data(c))
+            {
+                return field_ptr->contiguous_data(c);
+            }
+
+            // fields without a contiguous_data member function are always packed
+            template<typename Field, typename IndexContainer>
+            void* contiguous_data(Field*, const IndexContainer&, long)
+            {
+                return nullptr;
+            }
+
+            // derived datatype describing the halo region in field memory, found through argument dependent lookup
+            template<typename Datatype, typename Field, typename IndexContainer>
+            auto field_datatype(Field* field_ptr, const IndexContainer& c, int)
+                -> decltype((void)make_datatype(*field_ptr, c), std::shared_ptr<const Datatype>())
+            {
+                return std::shared_ptr<const Datatype>(new Datatype(make_datatype(*field_ptr, c)));
+            }
+
+            // fields without a make_datatype overload can only be packed
+            template<typename Datatype, typename Field, typename IndexContainer>
+            std::shared_ptr<const Datatype> field_datatype(Field*, const IndexContainer&, long)
+            {
+                throw std::runtime_error("field type does not support derived datatypes");
+            }
+
+            // address of field_type_id<Field>::value is unique for each field type
+            template<typename Field>
+            struct field_type_id { static const char value; };
+            template<typename Field>
+            const char field_type_id<Field>::value = 0;
+
+            // direct copy into another field of the same type, if the field supports it
+            template<typename Function, typename Field, typename IndexContainer>
+            auto make_local_copy(Field* field_ptr, const IndexContainer& c, int)
+                -> decltype(field_ptr->local_copy(*field_ptr, c, c), Function())
+            {
+                return [field_ptr](void* dst_field_ptr, const IndexContainer& src_c, const IndexContainer& dst_c)
+                {
+                    field_ptr->local_copy(*reinterpret_cast<Field*>(dst_field_ptr), src_c, dst_c);
+                };
+            }
+
+            // otherwise local halos are packed and unpacked
+            template<typename Function, typename Field, typename IndexContainer>
+            Function make_local_copy(Field*, const IndexContainer&, long)
+            {
+                return {};
+            }
+
+            // split of halo regions into parts which are packed one after the other, if the field supports it
+            template<typename Function, typename Field, typename IndexContainer>
+            auto make_split(Field* field_ptr, const IndexContainer& c, int)
+                -> decltype(field_ptr->split(c, std::size_t{1}), Function())
+            {
+                return [field_ptr](const IndexContainer& c, std::size_t max_elements)
+                {
+                    return field_ptr->split(c, max_elements);
+                };
+            }
+
+            // otherwise each halo region is transmitted as a whole
+            template<typename Function, typename Field, typename IndexContainer>
+            Function make_split(Field*, const IndexContainer&, long)
+            {
+                return {};
+            }
+
+            // unpack function which combines the received values with the field values, if the field supports it
+            template<typename Function, typename T, typename IndexContainer, typename Field, typename Op>
+            auto make_accumulate(Field* field_ptr, Op op, int)
+                -> decltype(field_ptr->accumulate((const T*)nullptr, std::declval<const IndexContainer&>(), op, nullptr), 
+                    Function())
+            {
+                return [field_ptr,op](const void* buffer, const IndexContainer& c, void* arg)
+                {
+                    field_ptr->accumulate(reinterpret_cast<const T*>(buffer), c, op, arg);
+                };
+            }
+
+            // halos restricted to a number of layers and a subset of directions, if the pattern supports it
+            template<typename IndexContainer>
+            auto clip_halos(const IndexContainer& c, const std::vector<int>& depth, const std::vector<bool>& directions,
+                int) -> decltype(IndexContainer::value_type::pattern_type::clip(c, depth, directions))
+            {
+                return IndexContainer::value_type::pattern_type::clip(c, depth, directions);
+            }
+
+            template<typename IndexContainer>
+            IndexContainer clip_halos(const IndexContainer&, const std::vector<int>&, const std::vector<bool>&, long)
+            {
+                throw std::runtime_error("pattern type does not support partial halo depths or direction masks");
+            }
+
+            // fields without an accumulate member function can not be used in reverse exchanges
+            template<typename Function, typename T, typename IndexContainer, typename Field, typename Op>
+            Function make_accumulate(Field*, Op, long)
+            {
+                throw std::runtime_error("field type does not support reverse exchanges");
+            }
+
+            // id which identifies a field, if the field has one (see structured::simple_field_wrapper::id)
+            template<typename Field>
+            auto field_id(const Field& f, int) -> decltype(static_cast<std::size_t>(f.id()))
+            {
+                return f.id();
+            }
+
+            // other fields are identified by their memory only
+            template<typename Field>
+            std::size_t field_id(const Field&, long)
+            {
+                return 0u;
+            }
+        } // namespace detail
+
+        /** @brief selects an automatically assigned id when constructing a communication object */
+        struct auto_id_t {};
+        constexpr auto_id_t auto_id{};
 
         /** @brief handle type for waiting on asynchronous communication processes.
-          * The wait function is stored in a member.
+          * The wait and test functions are stored in members.
           * @tparam Transport message transport type
           * @tparam GridType grid tag type
           * @tparam DomainIdType domain id type*/
@@ -42,6 +175,12 @@ namespace gridtools {
         private: // friend class
 
             friend class communication_object<Transport,GridType,DomainIdType>;
+            friend class exchange_plan<Transport,GridType,DomainIdType>;
+
+        public: // member types
+
+            /** @brief function called with the ids of a local domain and of a neighbor domain */
+            using neighbor_function_type = std::function<void(DomainIdType, DomainIdType)>;
 
         private: // member types
 
@@ -52,6 +191,9 @@ namespace gridtools {
 
             communicator_type m_comm;
             std::function<void()> m_wait_fct;
+            std::function<bool()> m_test_fct;
+            std::function<void(const neighbor_function_type&)> m_wait_neighbor_fct;
+            std::function<void(const void*)> m_wait_field_fct;
 
         public: // public constructor
 
@@ -70,6 +212,16 @@ namespace gridtools {
             communication_handle(const communicator_type& comm, Func&& wait_fct) 
             : m_comm{comm}, m_wait_fct(std::forward<Func>(wait_fct)) {}
 
+            /** @brief construct a handle with a wait and a test function
+              * @tparam Func function type with signature void()
+              * @tparam TestFunc function type with signature bool()
+              * @param comm communicator
+              * @param wait_fct wait function
+              * @param test_fct test function */
+            template<typename Func, typename TestFunc>
+            communication_handle(const communicator_type& comm, Func&& wait_fct, TestFunc&& test_fct) 
+            : m_comm{comm}, m_wait_fct(std::forward<Func>(wait_fct)), m_test_fct(std::forward<TestFunc>(test_fct)) {}
+
         public: // copy and move ctors
 
             communication_handle(communication_handle&&) = default;
@@ -81,6 +233,56 @@ namespace gridtools {
 
             /** @brief  wait for communication to be finished*/
             void wait() { if (m_wait_fct) m_wait_fct(); }
+
+            /** @brief wait for communication to be finished, and call a function as soon as the halos which a 
+              * local domain receives from a neighbor domain have been unpacked, e.g. to compute the boundary 
+              * region next to that neighbor while other messages are still in transit. Halos copied between 
+              * domains of this rank are complete and are reported first. Messages are unpacked one at a time by
+              * the calling thread in the order of arrival (also if a thread pool is used), and the function is 
+              * called from the calling thread.
+              * @tparam Func function type with signature void(domain_id_type local_id, domain_id_type neighbor_id)
+              * @param f function */
+            template<typename Func>
+            void wait(Func&& f)
+            {
+                if (m_wait_neighbor_fct) 
+                    m_wait_neighbor_fct(neighbor_function_type(std::forward<Func>(f)));
+                else if (m_wait_fct)
+                    throw std::runtime_error("this exchange does not support per neighbor continuations");
+            }
+
+            /** @brief wait until the halos of one field of a multi-field exchange have been unpacked, such that 
+              * computation on this field can start while the halos of other fields are still in transit. The 
+              * messages holding halos of the field are unpacked by the calling thread in the order of arrival, 
+              * along with the other fields they hold. Fields only arrive separately if buffers are split into 
+              * several messages (see communication_object::set_chunk_size): throws if the halos of the field 
+              * share an unsplit buffer with other fields, i.e. for exchanges without chunking and for plans, 
+              * which are never chunked. The exchange must still be completed with wait() or test(). Falls back 
+              * to wait() if the exchange does not support it.
+              * @tparam Field field type
+              * @param field field object which was bound to the pattern */
+            template<typename Field>
+            void wait_field(const Field& field)
+            {
+                if (m_wait_field_fct) 
+                    m_wait_field_fct(&field);
+                else
+                    wait();
+            }
+
+            /** @brief progress the communication without blocking: unpack all halos which have arrived so far. 
+              * If no test function is available, this function falls back to wait().
+              * @return true if the communication is finished */
+            bool progress()
+            {
+                if (m_test_fct) return m_test_fct();
+                wait();
+                return true;
+            }
+
+            /** @brief same as progress()
+              * @return true if the communication is finished */
+            bool test() { return progress(); }
         };
 
      
@@ -95,11 +297,14 @@ namespace gridtools {
         private: // friend class
 
             friend class communication_handle<Transport,GridType,DomainIdType>;
+            friend class exchange_plan<Transport,GridType,DomainIdType>;
 
         public: // member types
 
             /** @brief handle type returned by exhange operation */
             using handle_type             = communication_handle<Transport,GridType,DomainIdType>;
+            /** @brief plan type returned by make_plan */
+            using plan_type               = exchange_plan<Transport,GridType,DomainIdType>;
             using transport_type          = Transport;
             using grid_type               = GridType;
             using domain_id_type          = DomainIdType;
@@ -113,10 +318,14 @@ namespace gridtools {
         private: // member types
 
             using communicator_type       = typename handle_type::communicator_type;
+            using neighbor_function_type  = typename handle_type::neighbor_function_type;
             using address_type            = typename communicator_type::address_type;
             using index_container_type    = typename pattern_type::index_container_type;
+            using map_type                = typename pattern_type::map_type;
             using pack_function_type      = std::function<void(void*,const index_container_type&, void*)>;
             using unpack_function_type    = std::function<void(const void*,const index_container_type&, void*)>;
+            using local_copy_function_type= std::function<void(void*,const index_container_type&,const index_container_type&)>;
+            using split_function_type     = std::function<std::vector<index_container_type>(const index_container_type&, std::size_t)>;
 
             /** @brief pair of domain ids with ordering */
             struct domain_id_pair
@@ -132,8 +341,15 @@ namespace gridtools {
 
             /** @brief Holds a pointer to a set of iteration spaces and a callback function pointer 
               * which is used to store a field's pack or unpack member function. 
-              * This class also stores the offset in the serialized buffer in bytes.
+              * This class also stores the offset and size in the serialized buffer in bytes.
               * The type-erased field_ptr member is only used for the gpu-vector-interface.
+              * If the iteration spaces form a single region which is contiguous in field memory, zero_copy_ptr 
+              * points to its first element, and the data may be transmitted without packing. If the field is
+              * exchanged using derived datatypes, datatype describes the iteration spaces in field memory (shared,
+              * since field infos are copied into exchange plans). For halos exchanged with another domain on the
+              * same rank, local_copy copies directly into a field with the same field_type_id (if supported). If
+              * the field supports it, split cuts the iteration spaces into parts of a maximum number of points,
+              * which are packed one after the other (see set_chunk_size).
               * @tparam Function Either pack or unpack function pointer type */
             template<typename Function>
             struct field_info
@@ -143,9 +359,23 @@ namespace gridtools {
                 const index_container_type* index_container;
                 std::size_t offset;
                 void* field_ptr;
+                std::size_t size;
+                void* zero_copy_ptr;
+                std::shared_ptr<const typename communicator_type::datatype> datatype;
+                local_copy_function_type local_copy;
+                const void* field_type_id;
+                // owner of the halo map index_container points into, if it was clipped or split for this exchange
+                std::shared_ptr<const void> halos;
+                split_function_type split;
             };
 
-            /** @brief Holds serial buffer memory and meta information associated with it
+            /** @brief Holds serial buffer memory and meta information associated with it. If the buffer is 
+              * transmitted in several chunks, the chunks member holds the indices of the first field info of each 
+              * chunk followed by the number of field infos, and is empty otherwise. Field infos using derived
+              * datatypes always form a chunk of their own. Buffers between two domains on this rank which are both
+              * part of the exchange are marked local and are copied without communication. The ids member holds 
+              * the domain ids the buffer is stored with, and num_unpacked counts the field infos of a receive 
+              * buffer unpacked so far (see communication_handle::wait with continuation).
               * @tparam Vector contiguous buffer memory type
               * @tparam Function Either pack or unpack function pointer type */
             template<class Vector, class Function>
@@ -158,6 +388,21 @@ namespace gridtools {
                 std::size_t size;
                 std::vector<field_info_type> field_infos;
                 cuda::stream m_cuda_stream;
+                std::vector<std::size_t> chunks;
+                bool local;
+                domain_id_pair ids;
+                std::size_t num_unpacked;
+            };
+
+            /** @brief Refers to the range of field infos of a receive buffer which arrive in one message
+              * @tparam Buffer buffer type */
+            template<class Buffer>
+            struct buffer_hook
+            {
+                Buffer* m_buffer;
+                std::size_t m_first;
+                std::size_t m_last;
+                Buffer* operator->() const noexcept { return m_buffer; }
             };
 
             /** @brief Holds maps of buffers for send and recieve operations indexed by a domain_id_pair and a device id
@@ -179,26 +424,254 @@ namespace gridtools {
                 recv_memory_type recv_memory;
 
                 // additional members needed for receive operations used for scheduling calls to unpack
-                using hook_type       = recv_buffer_type*;
+                using hook_type       = buffer_hook<recv_buffer_type>;
                 using future_type     = typename communicator_type::template future<hook_type>;
                 std::vector<future_type> m_recv_futures;
 
+                // matching send and receive buffers between domains on this rank
+                std::vector<std::pair<send_buffer_type*, recv_buffer_type*>> m_local_pairs;
             };
             
             /** tuple type of buffer_memory (one element for each device in arch_list) */
             using memory_type = detail::transform<arch_list>::with<buffer_memory>;
 
+            /** @brief regular exchange: values of the owned regions are copied into the halos of the neighbors;
+              * fields with an unchanged version are skipped if requested (see buffer_info::version) */
+            struct forward_direction { bool skip_unchanged = false; };
+
+            /** @brief reverse exchange: values of the halos are sent back to the owning neighbors and combined
+              * into the owned regions
+              * @tparam Op binary operation */
+            template<typename Op>
+            struct reverse_direction { Op op; };
+
+            /** @brief identifies a versioned field exchange (see buffer_info::version): pattern, field id, field
+              * memory, halo depth and direction mask */
+            using version_key = std::tuple<const pattern_type*, std::size_t, const void*, std::vector<int>, 
+                std::vector<bool>>;
+
+            /** @brief buffers and progress of one exchange in flight (see set_max_in_flight) */
+            struct exchange_state
+            {
+                bool m_valid = false;
+                // index of this exchange among the exchanges whose tags are interleaved (see tag)
+                int m_tag_lane = 0;
+                // number of tags required by the exchanged patterns
+                int m_num_tags = 0;
+                memory_type m_mem;
+                std::vector<typename communicator_type::template future<void>> m_send_futures;
+                // second buffer set and the sends from it which may still be in progress (double buffering)
+                memory_type m_spare_mem;
+                std::vector<typename communicator_type::template future<void>> m_draining;
+                // set during reverse exchanges, whose unpacking must not run concurrently since different 
+                // messages combine into the same points
+                bool m_serial_unpack = false;
+                // chunk size with which the buffers were partitioned (see partition)
+                std::size_t m_chunk_size = 0u;
+                // global reduction started along with this exchange (see allreduce)
+                typename communicator_type::template future<void> m_reduction;
+                // versions of the fields in this exchange, recorded once it has completed
+                std::vector<std::pair<version_key, std::size_t>> m_versions;
+            };
+
+        public: // tag space
+
+            /** @brief number of communication object ids: each id other than 0 owns a range of 
+              * (MPI_TAG_UB+1)/num_tag_slots tags at the top of the tag space, id 0 owns the tags below the ranges
+              * of all other ids (whether they are in use or not) */
+            static constexpr int num_tag_slots = 64;
+
         private: // members
 
-            bool m_valid;
-            memory_type m_mem;
-            std::vector<typename communicator_type::template future<void>> m_send_futures;
+            tl::mpi::tag_slot m_slot;
+            // one state per exchange which may be in flight, used round robin
+            std::vector<std::unique_ptr<exchange_state>> m_states;
+            std::size_t m_next_state = 0u;
+            // state in which plans are compiled, whose tags are separate from those of the exchanges
+            std::unique_ptr<exchange_state> m_plan_state{new exchange_state()};
+            std::size_t m_next_plan = 0u;
+            std::size_t m_chunk_size = 0u;
+            thread_pool* m_thread_pool = nullptr;
+            bool m_double_buffering = false;
+            bool m_node_aggregation = false;
+            MPI_Comm m_node_comm = MPI_COMM_NULL;
+            std::shared_ptr<tl::mpi::node_topology> m_topology;
+            // last exchanged version of versioned fields
+            std::map<version_key, std::size_t> m_field_versions;
+            // global reduction to be started by the next exchange
+            std::function<typename communicator_type::template future<void>(const communicator_type&)> m_next_reduction;
 
         public: // ctors
 
-            communication_object() : m_valid(false) {}
+            /** @brief construct a communication object with id 0, whose exchanges use the tags which are not
+              * owned by any other id */
+            communication_object() { set_max_in_flight(1); }
+            /** @brief construct a communication object with an id, which selects the range of tags used in its
+              * exchanges (see num_tag_slots). Objects exchanging the same fields (possibly on different domains, 
+              * e.g. one object per thread owning a domain) must have the same id on all ranks, since sender and 
+              * receiver need to agree on the tags. Objects exchanging different fields on the same domains 
+              * concurrently (e.g. from different threads under MPI_THREAD_MULTIPLE) need different ids. Throws if 
+              * the id has been assigned automatically to a live communication object.
+              * @param id id between 0 and num_tag_slots-1 (default 0) */
+            explicit communication_object(int id) : m_slot{id, num_tag_slots-1} { set_max_in_flight(1); }
+            /** @brief construct a communication object with an automatically assigned id: the lowest id above 0
+              * which is not used by a live communication object on any rank of the communicator. Objects created
+              * this way never share tags with other live objects. Collective over the communicator, such that all
+              * ranks obtain the same id: all ranks must create these objects in the same order, and threads of a
+              * rank must not create them concurrently (objects created concurrently need explicit ids). Throws if
+              * all ids are in use.
+              * @param comm communicator of the patterns exchanged by this object */
+            communication_object(auto_id_t, const communicator_type& comm)
+            : m_slot{tl::mpi::tag_slot::lowest_free(num_tag_slots-1, comm)}
+            {
+                set_max_in_flight(1);
+            }
             communication_object(const communication_object&) = delete;
             communication_object(communication_object&&) = default;
+            ~communication_object()
+            {
+                for (auto& st : m_states) drain(*st);
+            }
+
+        public: // configuration
+
+            /** @brief set the message size in bytes above which a buffer is split into several messages at field
+              * boundaries, such that the first chunks are on the wire while the remaining ones are still being 
+              * packed. Fields larger than the chunk size are split into parts of consecutive halo points first,
+              * if the field type supports it (see structured::simple_field_wrapper::split), such that a single
+              * large field is transmitted in several chunks as well. Only applies to devices whose packer supports
+              * chunking (cpu) and to exchanges which are not compiled into a plan. All communicating ranks must use
+              * the same chunk size.
+              * @param s chunk size in bytes (0 disables chunking, default) */
+            void set_chunk_size(std::size_t s) noexcept { m_chunk_size = s; }
+
+            /** @return chunk size in bytes */
+            std::size_t chunk_size() const noexcept { return m_chunk_size; }
+
+            /** @brief use a thread pool for packing and unpacking. Pack and unpack callbacks of different buffers
+              * are then executed concurrently by the pool's threads, while all communication is still issued by
+              * the calling thread, as soon as a buffer is packed. Exchange plans created afterwards use the same
+              * pool. The pool must outlive all exchanges using it.
+              * @param pool pointer to a thread pool (nullptr disables threaded packing, default) */
+            void set_thread_pool(thread_pool* pool) noexcept { m_thread_pool = pool; }
+
+            /** @return pointer to the thread pool used for packing and unpacking */
+            thread_pool* get_thread_pool() const noexcept { return m_thread_pool; }
+
+            /** @brief aggregate the messages between nodes in exchange plans created afterwards: the ranks of a
+              * node pack their messages to other nodes into a shared memory window, and the node leader (the rank
+              * with the lowest node-local rank) sends one message per remote node, which combines the messages of
+              * all ranks of the node. Received messages are unpacked by each rank from the window. This reduces 
+              * the number of messages between nodes and hence latency for small halos. Messages within a node are
+              * sent directly. Only applies to plans (see make_plan), since the layout of the window is computed
+              * collectively once per plan: exchanges started through exchange() or reverse_exchange() are never
+              * aggregated. Creating, executing, completing and destroying aggregated plans is collective over
+              * the ranks of a node, and all ranks must enable aggregation. Only devices whose packer supports
+              * aggregation (cpu) are aggregated. Each plan reserves one tag in addition to those required by its
+              * patterns for aggregated messages while aggregation is enabled.
+              * @param flag whether to aggregate messages between nodes
+              * @param node_comm communicator grouping the ranks into nodes whose members must be able to share 
+              * memory (default MPI_COMM_NULL: shared memory domains as given by MPI_Comm_split_type) */
+            void set_node_aggregation(bool flag, MPI_Comm node_comm = MPI_COMM_NULL)
+            {
+                if (node_comm != m_node_comm) m_topology.reset();
+                m_node_aggregation = flag;
+                m_node_comm = node_comm;
+            }
+
+            /** @return whether messages between nodes are aggregated in exchange plans (exchanges are not 
+              * aggregated) */
+            bool node_aggregation() const noexcept { return m_node_aggregation; }
+
+            /** @brief set the number of exchanges which may be in flight at the same time, e.g. for different
+              * groups of fields. Each of them has its own buffers and every 2n-th tag of this object's tag range,
+              * such that their messages can not be confused. Exchanges take the buffers and tags round robin: an
+              * exchange throws if the one started n exchanges earlier has not been finished. All ranks must 
+              * therefore use the same number and start their exchanges in the same order. The remaining tags are
+              * reserved for plans, which take them round robin as well (see make_plan). Must not be called while
+              * exchanges are in flight; plans created before must not be executed afterwards.
+              * @param n maximum number of exchanges in flight (at least 1, default 1) */
+            void set_max_in_flight(int n)
+            {
+                if (n < 1)
+                    throw std::runtime_error("number of exchanges in flight must be at least 1");
+                for (const auto& st : m_states)
+                    if (st->m_valid) throw std::runtime_error("earlier exchange operation was not finished");
+                for (auto& st : m_states) drain(*st);
+                m_states.resize(n);
+                for (int k=0; k<n; ++k)
+                {
+                    if (!m_states[k]) m_states[k].reset(new exchange_state());
+                    m_states[k]->m_tag_lane = k;
+                }
+                m_next_state = 0u;
+                m_next_plan = 0u;
+            }
+
+            /** @return number of exchanges which may be in flight at the same time */
+            int max_in_flight() const noexcept { return m_states.size(); }
+
+            /** @brief alternate between two sets of send buffers in consecutive exchanges: waiting on an exchange
+              * then only completes its receives and the sends of the previous exchange, whose buffers are reused
+              * next, while its own sends may still be in progress. The next exchange can thus be packed while the
+              * messages of the last one are still being transmitted. Since the field memory may be modified after
+              * waiting, halos are always packed for sending and derived datatypes can not be used. Exchange plans
+              * own their buffers and are not affected.
+              * @param flag whether to use double buffering (default false) */
+            void set_double_buffering(bool flag) noexcept { m_double_buffering = flag; }
+
+            /** @return whether send buffers are double buffered */
+            bool double_buffering() const noexcept { return m_double_buffering; }
+
+            /** @return id of this communication object */
+            int id() const noexcept { return m_slot.id(); }
+
+            /** @return first tag used by this communication object */
+            int tag_offset() const 
+            { 
+                return id() == 0 ? 0 : static_cast<int>(tag_space() - id()*tag_slot_size()); 
+            }
+
+            /** @return number of tags available to this communication object, which only depends on the id and
+              * MPI_TAG_UB, such that it is the same on all ranks: id 0 owns the remainder of the tag space below 
+              * the ranges of the other ids */
+            std::int64_t tag_range() const 
+            { 
+                return id() == 0 ? tag_space() - (num_tag_slots-1)*tag_slot_size() : tag_slot_size();
+            }
+
+        public: // versioned fields
+
+            /** @brief forget the versions of all fields exchanged so far (see buffer_info::version), e.g. after
+              * fields have been destroyed, such that their entries do not accumulate. The next exchange of each 
+              * versioned field is then not skipped. All ranks must reset the versions at the same point.*/
+            void reset_versions() { m_field_versions.clear(); }
+
+        public: // global reductions
+
+            /** @brief attach a global reduction to the next exchange (or reverse exchange): a non-blocking 
+              * MPI_Iallreduce is started on the communicator of the exchange right after the halos have been 
+              * sent, and is completed when the exchange is waited for (or tested), such that the latencies of both
+              * overlap. This suits small payloads, e.g. residual norms of iterative solvers. Since the reduction is
+              * collective, all ranks of the communicator must attach reductions to the same sequence of exchanges.
+              * The buffers must stay valid until the exchange has been completed. Plans do not start reductions
+              * attached here (see exchange_plan::allreduce). Throws if a reduction is already attached to the 
+              * next exchange, which would be replaced otherwise.
+              * @tparam T arithmetic type
+              * @param send_buf values contributed by this rank (may equal recv_buf for an in-place reduction)
+              * @param recv_buf reduced values
+              * @param count number of values
+              * @param op reduction operation, e.g. MPI_SUM */
+            template<typename T>
+            void allreduce(const T* send_buf, T* recv_buf, int count, MPI_Op op)
+            {
+                if (m_next_reduction)
+                    throw std::runtime_error("a reduction is already attached to the next exchange");
+                m_next_reduction = [send_buf,recv_buf,count,op](const communicator_type& comm)
+                { 
+                    return comm.allreduce(send_buf, recv_buf, count, op); 
+                };
+            }
 
         public: // exchange arbitrary field-device-pattern combinations
 
@@ -212,7 +685,26 @@ namespace gridtools {
                 exchange(buffer_infos...).wait();
             }
 
-            /** @brief non-blocking exchange of halo data
+            /** @brief blocking halo exchange in stages, e.g. dimension by dimension (see
+              * structured::make_staged_pattern). Each stage is completed before the next one starts, since later
+              * stages forward halo data received in earlier ones.
+              * @tparam Archs list of device types
+              * @tparam Fields list of field types
+              * @param stages buffer_info objects per stage, created by binding a field descriptor to a staged
+              * pattern */
+            template<typename... Archs, typename... Fields>
+            void bexchange_staged(const std::vector<buffer_info_type<Archs,Fields>>&... stages)
+            {
+                const std::array<std::size_t,sizeof...(Fields)> num_stages{stages.size()...};
+                for (auto n : num_stages)
+                    if (n != num_stages[0])
+                        throw std::runtime_error("all fields must be bound to patterns with the same number of stages");
+                for (std::size_t i=0; i<num_stages[0]; ++i)
+                    exchange(stages[i]...).wait();
+            }
+
+            /** @brief non-blocking exchange of halo data. Halos between two domains of this rank whose fields are 
+              * both part of the exchange are copied directly (on the host) before this function returns.
               * @tparam Archs list of device types
               * @tparam Fields list of field types
               * @param buffer_infos buffer_info objects created by binding a field descriptor to a pattern
@@ -220,47 +712,7 @@ namespace gridtools {
             template<typename... Archs, typename... Fields>
             [[nodiscard]] handle_type exchange(buffer_info_type<Archs,Fields>... buffer_infos)
             {
-                // check that arguments are compatible
-                using test_t = pattern_container<transport_type,grid_type,domain_id_type>;
-                static_assert(detail::test_eq_t<test_t, typename buffer_info_type<Archs,Fields>::pattern_container_type...>::value,
-                        "patterns are not compatible with this communication object");
-                if (m_valid) 
-                    throw std::runtime_error("earlier exchange operation was not finished");
-                m_valid = true;
-
-                // temporarily store address of pattern containers
-                const test_t* ptrs[sizeof...(Fields)] = { &(buffer_infos.get_pattern_container())... };
-                // build a tag map
-                std::map<const test_t*,int> pat_ptr_map;
-                int max_tag = 0;
-                for (unsigned int k=0; k<sizeof...(Fields); ++k)
-                {
-                    auto p_it_bool = pat_ptr_map.insert( std::make_pair(ptrs[k], max_tag) );
-                    if (p_it_bool.second == true)
-                        max_tag += ptrs[k]->max_tag()+1;
-                }
-                // compute tag offset for each field
-                int tag_offsets[sizeof...(Fields)] = { pat_ptr_map[&(buffer_infos.get_pattern_container())]... };
-                // store arguments and corresponding memory in tuples
-                using buffer_infos_ptr_t     = std::tuple<std::remove_reference_t<decltype(buffer_infos)>*...>;
-                using memory_t               = std::tuple<buffer_memory<Archs>*...>;
-                buffer_infos_ptr_t buffer_info_tuple{&buffer_infos...};
-                memory_t memory_tuple{&(std::get<buffer_memory<Archs>>(m_mem))...};
-                // loop over buffer_infos/memory and compute required space
-                int i = 0;
-                detail::for_each(memory_tuple, buffer_info_tuple, [this,&i,&tag_offsets](auto mem, auto bi) 
-                {
-                    using arch_type = typename std::remove_reference_t<decltype(*mem)>::arch_type;
-                    using value_type  = typename std::remove_reference_t<decltype(*bi)>::value_type;
-                    auto field_ptr = &(bi->get_field());
-                    const domain_id_type my_dom_id = bi->get_field().domain_id();
-                    allocate<arch_type,value_type>(mem, bi->get_pattern(), field_ptr, my_dom_id, bi->device_id(), tag_offsets[i]);
-                    ++i;
-                });
-                handle_type h(std::get<0>(buffer_info_tuple)->get_pattern().communicator(), [this](){this->wait();});
-                post_recvs(h.m_comm);
-                pack(h.m_comm);
-                return h; 
+                return start_exchange(forward_direction{true}, buffer_infos...);
             }
 
         public: // exchange a number of buffer_infos with identical type (same field, device and pattern type)
@@ -274,10 +726,125 @@ namespace gridtools {
             template<typename Arch, typename Field>
             [[nodiscard]] handle_type exchange(buffer_info_type<Arch,Field>* first, std::size_t length)
             {
-                auto h = exchange_impl(first, length);
-                post_recvs(h.m_comm);
-                pack(h.m_comm);
-                return h;
+                return start_exchange(forward_direction{true}, first, length);
+            }
+
+        public: // compile an exchange into a reusable plan
+
+            /** @brief compile an exchange of a fixed set of fields into a plan. The plan owns its buffers and 
+              * stores tags, buffer sizes, offsets and pack/unpack callbacks in flat arrays, such that repeated 
+              * exchanges of the same fields only need to pack, post and unpack. This communication object is left 
+              * in a ready state and can be used for other exchanges afterwards. Plans transmit whole buffers,
+              * irrespective of the chunk size, except that fields using derived datatypes are sent separately.
+              * Plans use tags reserved for them, so they can be executed while exchanges of this object are in
+              * flight. Consecutive plans take the tags round robin (see set_max_in_flight): at most 
+              * max_in_flight() plans of this object, created in the same order on all ranks, may be executed at
+              * the same time.
+              * @tparam Archs list of device types
+              * @tparam Fields list of field types
+              * @param buffer_infos buffer_info objects created by binding a field descriptor to a pattern
+              * @return exchange plan */
+            template<typename... Archs, typename... Fields>
+            [[nodiscard]] plan_type make_plan(buffer_info_type<Archs,Fields>... buffer_infos)
+            {
+                return compile_plan(forward_direction{}, m_thread_pool, buffer_infos...);
+            }
+
+            /** @brief compile an exchange into a plan, vector interface
+              * @tparam Arch device type
+              * @tparam Field field type
+              * @param first pointer to first buffer_info object
+              * @param length number of buffer_infos
+              * @return exchange plan */
+            template<typename Arch, typename Field>
+            [[nodiscard]] plan_type make_plan(buffer_info_type<Arch,Field>* first, std::size_t length)
+            {
+                return compile_plan(forward_direction{}, m_thread_pool, first, length);
+            }
+
+        public: // warm-up
+
+            /** @brief pre-allocate everything an exchange of the given fields needs, without communicating: the
+              * buffers and their meta data are set up and the buffer memory is reserved (and touched on the host,
+              * such that its pages are mapped) for each exchange which may be in flight and for both buffer sets
+              * if double buffering is enabled. The first exchanges of these fields then do not allocate, which
+              * avoids a latency spike at startup. Exchanges of other fields or reverse exchanges may still 
+              * allocate. Must not be called while exchanges are in flight, and waits for sends of double buffered
+              * exchanges which are still in progress.
+              * @tparam Archs list of device types
+              * @tparam Fields list of field types
+              * @param buffer_infos buffer_info objects created by binding a field descriptor to a pattern */
+            template<typename... Archs, typename... Fields>
+            void reserve(buffer_info_type<Archs,Fields>... buffer_infos)
+            {
+                reserve_impl([this,&buffer_infos...](exchange_state& st)
+                {
+                    return exchange_impl(st, forward_direction{}, buffer_infos...);
+                });
+            }
+
+            /** @brief pre-allocate everything an exchange needs, vector interface
+              * @tparam Arch device type
+              * @tparam Field field type
+              * @param first pointer to first buffer_info object
+              * @param length number of buffer_infos */
+            template<typename Arch, typename Field>
+            void reserve(buffer_info_type<Arch,Field>* first, std::size_t length)
+            {
+                reserve_impl([this,first,length](exchange_state& st)
+                {
+                    return exchange_impl(st, forward_direction{}, first, length);
+                });
+            }
+
+        public: // reverse exchange
+
+            /** @brief non-blocking reverse exchange: the halo regions of each field are sent back to the domains 
+              * owning them and are combined with the owner's values, i.e. every owned point x which lies in a 
+              * neighbor's halo region is updated as x = op(x, h) for each halo point h referring to it. The 
+              * pattern's send and receive maps are used with swapped roles, and halos between domains of this 
+              * rank are combined directly. The halo values are not modified. Derived datatypes are not used in 
+              * reverse exchanges, and a thread pool is only used for packing, since received halos are combined 
+              * in the order of arrival, one at a time. Fields must provide an accumulate member function (cpu 
+              * fields).
+              * @tparam Op binary operation, e.g. std::plus<>
+              * @tparam Archs list of device types
+              * @tparam Fields list of field types
+              * @param op operation combining the owner's value with a received halo value
+              * @param buffer_infos buffer_info objects created by binding a field descriptor to a pattern
+              * @return handle to await communication */
+            template<typename Op, typename... Archs, typename... Fields>
+            [[nodiscard]] handle_type reverse_exchange(Op op, buffer_info_type<Archs,Fields>... buffer_infos)
+            {
+                return start_exchange(reverse_direction<Op>{op}, buffer_infos...);
+            }
+
+            /** @brief non-blocking reverse exchange, vector interface
+              * @tparam Op binary operation
+              * @tparam Arch device type
+              * @tparam Field field type
+              * @param op operation combining the owner's value with a received halo value
+              * @param first pointer to first buffer_info object
+              * @param length number of buffer_infos
+              * @return handle to await exchange */
+            template<typename Op, typename Arch, typename Field>
+            [[nodiscard]] handle_type reverse_exchange(Op op, buffer_info_type<Arch,Field>* first, std::size_t length)
+            {
+                return start_exchange(reverse_direction<Op>{op}, first, length);
+            }
+
+            /** @brief compile a reverse exchange into a plan (see reverse_exchange and make_plan)
+              * @tparam Op binary operation
+              * @tparam Archs list of device types
+              * @tparam Fields list of field types
+              * @param op operation combining the owner's value with a received halo value
+              * @param buffer_infos buffer_info objects created by binding a field descriptor to a pattern
+              * @return exchange plan */
+            template<typename Op, typename... Archs, typename... Fields>
+            [[nodiscard]] plan_type make_reverse_plan(Op op, buffer_info_type<Archs,Fields>... buffer_infos)
+            {
+                // unpacking is serial (see reverse_exchange), hence the plan does not use the thread pool
+                return compile_plan(reverse_direction<Op>{op}, nullptr, buffer_infos...);
             }
 
         public: // exchange a number of buffer_infos with Field = simple_field_wrapper (optimization for gpu below)
@@ -292,11 +859,17 @@ namespace gridtools {
                 using memory_t   = buffer_memory<gpu>;
                 using field_type = std::remove_reference_t<decltype(first->get_field())>;
                 using value_type = typename field_type::value_type;
-                auto h = exchange_impl(first, length);
-                post_recvs(h.m_comm);
-                h.m_wait_fct = [this](){this->wait_u<value_type,field_type>();};
-                memory_t& mem = std::get<memory_t>(m_mem);
-                packer<gpu>::template pack_u<value_type,field_type>(mem, m_send_futures, h.m_comm);
+                auto& st = next_state();
+                auto h = exchange_impl(st, forward_direction{}, first, length);
+                partition(st, m_chunk_size);
+                post_recvs(st, h.m_comm);
+                h.m_wait_fct = [this,&st](){this->wait_u<value_type,field_type>(st);};
+                h.m_test_fct = nullptr;
+                h.m_wait_neighbor_fct = nullptr;
+                h.m_wait_field_fct = nullptr;
+                memory_t& mem = std::get<memory_t>(st.m_mem);
+                packer<gpu>::template pack_u<value_type,field_type>(mem, st.m_send_futures, h.m_comm);
+                start_reduction(st, h.m_comm);
                 return h;
             }
 #endif
@@ -312,16 +885,113 @@ namespace gridtools {
 
         private: // implementation
 
-            template<typename Arch, typename Field>
-            [[nodiscard]] handle_type exchange_impl(buffer_info_type<Arch,Field>* first, std::size_t length)
+            // start an exchange in the next state: set up the buffers of the fields (see exchange_impl), post the
+            // receives, pack and send, start the attached reduction and copy the halos between domains of this rank;
+            // received halos are combined in reverse exchanges, hence they are unpacked serially
+            template<typename Direction, typename... Args>
+            [[nodiscard]] handle_type start_exchange(const Direction& dir, Args&&... args)
+            {
+                auto& st = next_state();
+                auto h = exchange_impl(st, dir, std::forward<Args>(args)...);
+                st.m_serial_unpack = !std::is_same<Direction,forward_direction>::value;
+                prepare(st, m_chunk_size, h.m_comm.address());
+                post_recvs(st, h.m_comm);
+                pack(st, h.m_comm);
+                start_reduction(st, h.m_comm);
+                copy_local(st);
+                return h;
+            }
+
+            // compile an exchange into a plan in the plan state, which takes the next tags reserved for plans; the
+            // plan state is left ready for the next plan
+            template<typename Direction, typename... Args>
+            [[nodiscard]] plan_type compile_plan(const Direction& dir, thread_pool* pool, Args&&... args)
+            {
+                auto& st = plan_state();
+                auto h = exchange_impl(st, dir, std::forward<Args>(args)...);
+                try
+                {
+                    prepare(st, 0u, h.m_comm.address());
+                    plan_type plan(h.m_comm, st.m_mem, pool, node_topology(h.m_comm), last_tag(st));
+                    clear(st);
+                    m_next_plan = (m_next_plan+1) % m_states.size();
+                    return plan;
+                }
+                catch (...)
+                {
+                    clear(st);
+                    throw;
+                }
+            }
+
+            template<typename Direction, typename... Archs, typename... Fields>
+            [[nodiscard]] handle_type exchange_impl(exchange_state& st, const Direction& dir, 
+                buffer_info_type<Archs,Fields>... buffer_infos)
+            {
+                // check that arguments are compatible
+                using test_t = pattern_container<transport_type,grid_type,domain_id_type>;
+                static_assert(detail::test_eq_t<test_t, typename buffer_info_type<Archs,Fields>::pattern_container_type...>::value,
+                        "patterns are not compatible with this communication object");
+
+                // temporarily store address of pattern containers
+                const test_t* ptrs[sizeof...(Fields)] = { &(buffer_infos.get_pattern_container())... };
+                // build a tag map
+                std::map<const test_t*,int> pat_ptr_map;
+                int max_tag = 0;
+                for (unsigned int k=0; k<sizeof...(Fields); ++k)
+                {
+                    auto p_it_bool = pat_ptr_map.insert( std::make_pair(ptrs[k], max_tag) );
+                    if (p_it_bool.second == true)
+                        max_tag += ptrs[k]->max_tag()+1;
+                }
+                check_tag_range(st, max_tag);
+                const bool uses_datatype[sizeof...(Fields)] = { buffer_infos.uses_datatype()... };
+                for (auto flag : uses_datatype) check_double_buffering(flag);
+                // compute tag offset for each field
+                int tag_offsets[sizeof...(Fields)] = { tag(st, pat_ptr_map[&(buffer_infos.get_pattern_container())])... };
+                // store arguments and corresponding memory in tuples
+                using buffer_infos_ptr_t     = std::tuple<std::remove_reference_t<decltype(buffer_infos)>*...>;
+                using memory_t               = std::tuple<buffer_memory<Archs>*...>;
+                buffer_infos_ptr_t buffer_info_tuple{&buffer_infos...};
+                memory_t memory_tuple{&(std::get<buffer_memory<Archs>>(st.m_mem))...};
+                const auto& comm = std::get<0>(buffer_info_tuple)->get_pattern().communicator();
+                // loop over buffer_infos/memory and compute required space
+                claim(st, [this,&st,&dir,&comm,&tag_offsets,&memory_tuple,&buffer_info_tuple]()
+                {
+                    std::vector<char> skip;
+                    skip.reserve(sizeof...(Fields));
+                    detail::for_each(buffer_info_tuple, [this,&st,&dir,&skip](auto bi) 
+                    { 
+                        skip.push_back(unchanged(st, dir, *bi)); 
+                    });
+                    check_skipped(st, comm, skip);
+                    int i = 0;
+                    detail::for_each(memory_tuple, buffer_info_tuple, [this,&dir,&i,&skip,&tag_offsets](auto mem, auto bi) 
+                    {
+                        using arch_type = typename std::remove_reference_t<decltype(*mem)>::arch_type;
+                        using value_type  = typename std::remove_reference_t<decltype(*bi)>::value_type;
+                        if (skip[i]) { ++i; return; }
+                        auto field_ptr = &(bi->get_field());
+                        const domain_id_type my_dom_id = bi->get_field().domain_id();
+                        allocate<arch_type,value_type>(dir, mem, bi->get_pattern(), field_ptr, my_dom_id, bi->device_id(), tag_offsets[i],
+                            bi->uses_datatype(), bi->halo_depth(), bi->halo_directions());
+                        ++i;
+                    });
+                });
+                handle_type h(comm, [this,&st](){this->wait(st);}, [this,&st](){return this->test(st);});
+                h.m_wait_neighbor_fct = [this,&st](const neighbor_function_type& f){ this->wait(st, f); };
+                h.m_wait_field_fct = [this,&st](const void* field_ptr){ this->wait_field(st, field_ptr); };
+                return h;
+            }
+
+            template<typename Direction, typename Arch, typename Field>
+            [[nodiscard]] handle_type exchange_impl(exchange_state& st, const Direction& dir, 
+                buffer_info_type<Arch,Field>* first, std::size_t length)
             {
                 // check that arguments are compatible
                 using test_t = pattern_container<transport_type,grid_type,domain_id_type>;
                 static_assert(std::is_same<test_t, typename buffer_info_type<Arch,Field>::pattern_container_type>::value,
                         "patterns are not compatible with this communication object");
-                if (m_valid)
-                    throw std::runtime_error("earlier exchange operation was not finished");
-                m_valid = true;
 
                 // build a tag map
                 std::map<const test_t*,int> pat_ptr_map;
@@ -333,96 +1003,687 @@ namespace gridtools {
                     if (p_it_bool.second == true)
                         max_tag += ptr->max_tag()+1;
                 }
+                check_tag_range(st, max_tag);
+                for (std::size_t k=0; k<length; ++k) check_double_buffering((first+k)->uses_datatype());
                 // loop over buffer_infos/memory and compute required space
                 using memory_t               = buffer_memory<Arch>*;
                 using value_type             = typename buffer_info_type<Arch,Field>::value_type;
-                memory_t mem{&(std::get<buffer_memory<Arch>>(m_mem))};
-                for (std::size_t k=0; k<length; ++k)
+                memory_t mem{&(std::get<buffer_memory<Arch>>(st.m_mem))};
+                claim(st, [this,&st,&dir,first,length,&pat_ptr_map,mem]()
+                {
+                    std::vector<char> skip(length);
+                    for (std::size_t k=0; k<length; ++k) 
+                        skip[k] = unchanged(st, dir, *(first+k));
+                    check_skipped(st, first->get_pattern().communicator(), skip);
+                    for (std::size_t k=0; k<length; ++k)
+                    {
+                        if (skip[k]) continue;
+                        auto field_ptr = &((first+k)->get_field());
+                        auto tag_offset = tag(st, pat_ptr_map[&((first+k)->get_pattern_container())]);
+                        const auto my_dom_id  =(first+k)->get_field().domain_id();
+                        allocate<Arch,value_type>(dir, mem, (first+k)->get_pattern(), field_ptr, my_dom_id, (first+k)->device_id(), tag_offset,
+                            (first+k)->uses_datatype(), (first+k)->halo_depth(), (first+k)->halo_directions());
+                    }
+                });
+                handle_type h(first->get_pattern().communicator(), [this,&st](){this->wait(st);}, 
+                    [this,&st](){return this->test(st);});
+                h.m_wait_neighbor_fct = [this,&st](const neighbor_function_type& f){ this->wait(st, f); };
+                h.m_wait_field_fct = [this,&st](const void* field_ptr){ this->wait_field(st, field_ptr); };
+                return h;
+            }
+
+            // whether a versioned field can be skipped since it has been exchanged with the same version before;
+            // remembers the version otherwise, which is recorded when the exchange completes (see finish); the 
+            // versions recorded for a field which is exchanged without a version are discarded
+            template<typename BufferInfo>
+            bool unchanged(exchange_state& st, const forward_direction& dir, BufferInfo& bi)
+            {
+                if (!dir.skip_unchanged || (!bi.versioned() && m_field_versions.empty())) return false;
+                version_key key{&bi.get_pattern(), detail::field_id(bi.get_field(), 0), 
+                    static_cast<const void*>(bi.get_field().data()), bi.halo_depth(), bi.halo_directions()};
+                if (!bi.versioned())
+                {
+                    // all entries of the field, irrespective of halo depth and direction mask
+                    auto first = m_field_versions.lower_bound(
+                        version_key{std::get<0>(key), std::get<1>(key), std::get<2>(key), {}, {}});
+                    auto last = first;
+                    while (last != m_field_versions.end() && std::get<0>(last->first) == std::get<0>(key) &&
+                        std::get<1>(last->first) == std::get<1>(key) && std::get<2>(last->first) == std::get<2>(key)) 
+                        ++last;
+                    m_field_versions.erase(first, last);
+                    return false;
+                }
+                auto it = m_field_versions.find(key);
+                if (it != m_field_versions.end() && it->second == bi.version()) return true;
+                st.m_versions.emplace_back(std::move(key), bi.version());
+                return false;
+            }
+
+            template<typename Op, typename BufferInfo>
+            bool unchanged(exchange_state&, const reverse_direction<Op>&, BufferInfo&) { return false; }
+
+            // make sure that all ranks skip the same fields, since ranks would otherwise wait for halos which their
+            // neighbors skipped; collective over the communicator if any field is versioned (on all ranks alike)
+            void check_skipped(const exchange_state& st, const communicator_type& comm, 
+                const std::vector<char>& skip) const
+            {
+                if (st.m_versions.empty() && std::none_of(skip.begin(), skip.end(), [](char s) { return s; })) 
+                    return;
+                // minimum of the skip flags and of their negations: both are 0 if the ranks disagree
+                const std::size_t n = skip.size();
+                std::vector<int> flags(2*n);
+                for (std::size_t k=0; k<n; ++k)
                 {
-                    auto field_ptr = &((first+k)->get_field());
-                    auto tag_offset = pat_ptr_map[&((first+k)->get_pattern_container())];
-                    const auto my_dom_id  =(first+k)->get_field().domain_id();
-                    allocate<Arch,value_type>(mem, (first+k)->get_pattern(), field_ptr, my_dom_id, (first+k)->device_id(), tag_offset);
+                    flags[k]   = skip[k] ? 1 : 0;
+                    flags[n+k] = skip[k] ? 0 : 1;
                 }
-                return handle_type(first->get_pattern().communicator(), [this](){this->wait();});
+                comm.allreduce(flags.data(), flags.data(), static_cast<int>(2*n), MPI_MIN).wait();
+                for (std::size_t k=0; k<n; ++k)
+                    if (flags[k] == 0 && flags[n+k] == 0)
+                        throw std::runtime_error("field " + std::to_string(k) + " of the exchange is skipped on "
+                            "some ranks only: versions differ between ranks");
             }
 
-            void post_recvs(communicator_type& comm)
+            // mark a state as in flight and set up its buffers through the allocate function; if setting up fails
+            // (e.g. invalid halo depth), the state is released again, such that this object remains usable
+            template<typename Allocate>
+            void claim(exchange_state& st, Allocate&& allocate)
             {
-                detail::for_each(m_mem, [this,&comm](auto& m)
+                const auto next_state = m_next_state;
+                st.m_valid = true;
+                if (&st == m_states[m_next_state].get()) m_next_state = (m_next_state+1) % m_states.size();
+                try
+                {
+                    allocate();
+                }
+                catch (...)
                 {
+                    clear(st);
+                    m_next_state = next_state;
+                    throw;
+                }
+            }
+
+            // state of the next exchange, which must have been finished
+            exchange_state& next_state()
+            {
+                auto& st = *m_states[m_next_state];
+                if (st.m_valid)
+                    throw std::runtime_error("earlier exchange operation was not finished");
+                return st;
+            }
+
+            // number of tags in the tag space
+            static std::int64_t tag_space() { return static_cast<std::int64_t>(tl::mpi::tag_ub())+1; }
+
+            // number of tags owned by each id other than 0
+            static std::int64_t tag_slot_size() { return tag_space()/num_tag_slots; }
+
+            // state in which the next plan is compiled, using the next tags reserved for plans (which are taken
+            // once the plan has been created, see make_plan)
+            exchange_state& plan_state()
+            {
+                m_plan_state->m_tag_lane = m_states.size() + m_next_plan;
+                return *m_plan_state;
+            }
+
+            // number of interleaved tag sequences: one per exchange in flight and as many for plans
+            int tag_stride() const noexcept { return 2*m_states.size(); }
+
+            // i-th tag of an exchange (pattern tag plus the tag offset of its pattern container): the tags of the
+            // exchanges in flight are interleaved, such that each one uses only as many tags as its patterns need
+            int tag(const exchange_state& st, int i) const { return tag_offset() + i*tag_stride() + st.m_tag_lane; }
+
+            // tag following those of the exchanged patterns, reserved for aggregated messages
+            int last_tag(const exchange_state& st) const { return tag(st, st.m_num_tags); }
+
+            // make sure that the tags of an exchange stay within the tag range and remember their number; plans
+            // need one more tag for aggregated messages
+            void check_tag_range(exchange_state& st, int num_tags) const
+            {
+                const bool aggregated = m_node_aggregation && &st == m_plan_state.get();
+                if (static_cast<std::int64_t>(aggregated ? num_tags+1 : num_tags)*tag_stride() > tag_range())
+                    throw std::runtime_error("number of tags required by the exchange exceeds the tag range");
+                st.m_num_tags = num_tags;
+            }
+
+            // set up the buffers of all states (and buffer sets) through the allocate function and reserve memory
+            template<typename Allocate>
+            void reserve_impl(Allocate&& allocate)
+            {
+                for (const auto& st : m_states)
+                    if (st->m_valid) throw std::runtime_error("earlier exchange operation was not finished");
+                const auto next_state = m_next_state;
+                for (auto& st : m_states)
+                {
+                    drain(*st);
+                    for (int k=0; k<(m_double_buffering ? 2 : 1); ++k)
+                    {
+                        auto h = allocate(*st);
+                        prepare(*st, m_chunk_size, h.m_comm.address());
+                        reserve(*st);
+                        clear(*st);
+                        if (m_double_buffering) std::swap(st->m_mem, st->m_spare_mem);
+                    }
+                }
+                m_next_state = next_state;
+            }
+
+            // reserve the buffer memory and the vectors which are filled during an exchange
+            static void reserve(exchange_state& st)
+            {
+                std::size_t num_sends = 0u;
+                detail::for_each(st.m_mem, [&num_sends](auto& m)
+                {
+                    using arch_type = typename std::remove_reference_t<decltype(m)>::arch_type;
+                    for (auto& p0 : m.send_memory)
+                        for (auto& p1 : p0.second)
+                        {
+                            reserve<arch_type>(p1.second);
+                            if (!p1.second.local) num_sends += detail::num_messages(p1.second);
+                        }
+                    std::size_t num_recvs = 0u;
+                    for (auto& p0 : m.recv_memory)
+                        for (auto& p1 : p0.second)
+                        {
+                            reserve<arch_type>(p1.second);
+                            if (!p1.second.local) num_recvs += detail::num_messages(p1.second);
+                        }
+                    m.m_recv_futures.reserve(num_recvs);
+                });
+                st.m_send_futures.reserve(num_sends);
+                st.m_draining.reserve(num_sends);
+            }
+
+            template<typename Arch, typename Buffer>
+            static void reserve(Buffer& b)
+            {
+                if (b.size == 0u) return;
+                b.buffer.reserve(b.size);
+                // map the pages of host memory
+                if (std::is_same<Arch,cpu>::value) std::memset(b.buffer.data(), 0, b.size);
+            }
+
+            // derived datatypes send from field memory, which may be modified while sends are still in progress
+            void check_double_buffering(bool uses_datatype) const
+            {
+                if (m_double_buffering && uses_datatype)
+                    throw std::runtime_error("derived datatypes can not be used with double buffering");
+            }
+
+            // node topology used for aggregation in plans (created on first use, collective)
+            std::shared_ptr<tl::mpi::node_topology> node_topology(const communicator_type& comm)
+            {
+                if (!m_node_aggregation) return nullptr;
+                if (!m_topology)
+                    m_topology = (m_node_comm == MPI_COMM_NULL) ?
+                        std::make_shared<tl::mpi::node_topology>(comm) :
+                        std::make_shared<tl::mpi::node_topology>(comm, m_node_comm);
+                return m_topology;
+            }
+
+            // partition the buffers of an exchange into messages and pair up the buffers between domains of this rank
+            void prepare(exchange_state& st, std::size_t chunk_size, address_type address)
+            {
+                st.m_chunk_size = chunk_size;
+                partition(st, chunk_size);
+                match_local(st, address);
+            }
+
+            // split buffers into chunks at field boundaries
+            void partition(exchange_state& st, std::size_t chunk_size)
+            {
+                detail::for_each(st.m_mem, [this,chunk_size](auto& m)
+                {
+                    using arch_type = typename std::remove_reference_t<decltype(m)>::arch_type;
+                    if (!packer<arch_type>::supports_chunks) return;
+                    for (auto& p0 : m.send_memory)
+                        for (auto& p1 : p0.second)
+                            partition(p1.second, chunk_size);
+                    for (auto& p0 : m.recv_memory)
+                        for (auto& p1 : p0.second)
+                            partition(p1.second, chunk_size);
+                });
+            }
+
+            // fields larger than chunk_size are split into parts first (if chunk_size > 0); a new chunk starts at
+            // the first field which lies at least chunk_size bytes after the start of the current chunk (if 
+            // chunk_size > 0), and fields using derived datatypes are chunks of their own; since the field offsets
+            // and transmission modes on the sending and receiving side are identical, both sides arrive at the 
+            // same partition
+            template<typename Buffer>
+            void partition(Buffer& b, std::size_t chunk_size)
+            {
+                b.chunks.resize(0);
+                if (chunk_size > 0u) split(b, chunk_size);
+                if (b.field_infos.size() < 2u) return;
+                const bool typed = std::any_of(b.field_infos.begin(), b.field_infos.end(),
+                    [](const auto& fi) { return static_cast<bool>(fi.datatype); });
+                if (!typed && (chunk_size == 0u || b.size <= chunk_size)) return;
+                b.chunks.push_back(0u);
+                std::size_t chunk_start = 0u;
+                for (std::size_t i=1; i<b.field_infos.size(); ++i)
+                {
+                    const auto& fi = b.field_infos[i];
+                    if (fi.datatype || b.field_infos[i-1].datatype || 
+                        (chunk_size > 0u && fi.offset - chunk_start >= chunk_size))
+                    {
+                        b.chunks.push_back(i);
+                        chunk_start = fi.offset;
+                    }
+                }
+                if (b.chunks.size() < 2u)
+                    b.chunks.resize(0);
+                else
+                    b.chunks.push_back(b.field_infos.size());
+            }
+
+            // replace the field infos larger than chunk_size bytes by parts of at most chunk_size bytes (at least one
+            // point), if their field supports splitting; the parts only depend on the shape of the halo regions and
+            // the field layout, hence the sending and receiving side split alike
+            template<typename Buffer>
+            static void split(Buffer& b, std::size_t chunk_size)
+            {
+                using field_info_type = typename Buffer::field_info_type;
+                auto splits = [chunk_size](const field_info_type& fi) 
+                { 
+                    return fi.size > chunk_size && fi.split && !fi.datatype; 
+                };
+                if (std::none_of(b.field_infos.begin(), b.field_infos.end(), splits)) return;
+                std::vector<field_info_type> field_infos;
+                for (auto& fi : b.field_infos)
+                {
+                    if (!splits(fi))
+                    {
+                        field_infos.push_back(std::move(fi));
+                        continue;
+                    }
+                    const std::size_t element_size = fi.size/pattern_type::num_elements(*fi.index_container);
+                    auto parts = std::make_shared<const std::vector<index_container_type>>(
+                        fi.split(*fi.index_container, chunk_size/element_size));
+                    std::size_t offset = fi.offset;
+                    for (const auto& c : *parts)
+                    {
+                        field_infos.push_back(fi);
+                        auto& part = field_infos.back();
+                        part.index_container = &c;
+                        part.offset = offset;
+                        part.size = pattern_type::num_elements(c)*element_size;
+                        if (fi.zero_copy_ptr) 
+                            part.zero_copy_ptr = static_cast<char*>(fi.zero_copy_ptr) + (offset-fi.offset);
+                        part.halos = parts;
+                        offset += part.size;
+                    }
+                }
+                b.field_infos = std::move(field_infos);
+            }
+
+            // find the send buffers addressed to this rank whose matching receive buffer (same domain pair) is
+            // part of this exchange; these are copied locally instead of being sent
+            void match_local(exchange_state& st, address_type address)
+            {
+                detail::for_each(st.m_mem, [address](auto& m)
+                {
+                    using arch_type = typename std::remove_reference_t<decltype(m)>::arch_type;
+                    if (!packer<arch_type>::supports_local_copy) return;
+                    for (auto& p0 : m.send_memory)
+                    {
+                        auto r0 = m.recv_memory.find(p0.first);
+                        if (r0 == m.recv_memory.end()) continue;
+                        for (auto& p1 : p0.second)
+                        {
+                            if (p1.second.size == 0u || p1.second.address != address) continue;
+                            auto r1 = r0->second.find(p1.first);
+                            if (r1 == r0->second.end() || !matches(p1.second, r1->second)) continue;
+                            p1.second.local = r1->second.local = true;
+                            m.m_local_pairs.emplace_back(&p1.second, &r1->second);
+                        }
+                    }
+                });
+            }
+
+            // a receive buffer matches a send buffer if it holds the same number of fields with equal sizes
+            template<typename SendBuffer, typename RecvBuffer>
+            static bool matches(const SendBuffer& s, const RecvBuffer& r) noexcept
+            {
+                if (r.size != s.size || r.tag != s.tag || r.field_infos.size() != s.field_infos.size()) return false;
+                for (std::size_t i=0; i<s.field_infos.size(); ++i)
+                    if (r.field_infos[i].size != s.field_infos[i].size) return false;
+                return true;
+            }
+
+            // copy the halos of all local buffers, using the thread pool if available
+            void copy_local(exchange_state& st)
+            {
+                detail::for_each(st.m_mem, [this,&st](auto& m) { copy_local_pairs(m, unpack_pool(st)); });
+            }
+
+            // copy from the fields of a send buffer into the fields of the matching receive buffer: into or from
+            // field memory directly if one side is contiguous, through the field's local_copy if both fields have
+            // the same type, and by packing into and unpacking from the receive buffer otherwise
+            template<typename SendBuffer, typename RecvBuffer>
+            static void copy_local(SendBuffer& s, RecvBuffer& r)
+            {
+                for (std::size_t i=0; i<s.field_infos.size(); ++i)
+                {
+                    const auto& sf = s.field_infos[i];
+                    const auto& rf = r.field_infos[i];
+                    if (rf.zero_copy_ptr)
+                        sf.call_back(rf.zero_copy_ptr, *sf.index_container, nullptr);
+                    else if (sf.zero_copy_ptr)
+                        rf.call_back(sf.zero_copy_ptr, *rf.index_container, nullptr);
+                    else if (sf.local_copy && sf.field_type_id == rf.field_type_id)
+                        sf.local_copy(rf.field_ptr, *sf.index_container, *rf.index_container);
+                    else
+                    {
+                        r.buffer.resize(r.size);
+                        sf.call_back(r.buffer.data() + rf.offset, *sf.index_container, nullptr);
+                        rf.call_back(r.buffer.data() + rf.offset, *rf.index_container, nullptr);
+                    }
+                }
+            }
+
+            void post_recvs(exchange_state& st, communicator_type& comm)
+            {
+                detail::for_each(st.m_mem, [&comm](auto& m)
+                {
+                    using future_type = typename std::remove_reference_t<decltype(m)>::future_type;
+                    using hook_type   = typename std::remove_reference_t<decltype(m)>::hook_type;
                     for (auto& p0 : m.recv_memory)
                     {
                         for (auto& p1: p0.second)
                         {
-                            if (p1.second.size > 0u)
+                            auto& b = p1.second;
+                            if (b.size == 0u || b.local) continue;
+                            const std::size_t n = detail::num_messages(b);
+                            // buffer memory is only needed for messages which are unpacked
+                            for (std::size_t c=0; c<n; ++c)
+                            {
+                                if (detail::is_packed(b, detail::first_field(b, c), detail::first_field(b, c+1)))
+                                {
+                                    b.buffer.resize(b.size);
+                                    break;
+                                }
+                            }
+                            for (std::size_t c=0; c<n; ++c)
                             {
-                                p1.second.buffer.resize(p1.second.size);
-                                m.m_recv_futures.emplace_back(
-                                    typename std::remove_reference_t<decltype(m)>::future_type{
-                                        &p1.second,
-                                        comm.recv(p1.second.buffer, p1.second.address, p1.second.tag).m_handle});
+                                m.m_recv_futures.emplace_back(future_type{
+                                    hook_type{&b, detail::first_field(b, c), detail::first_field(b, c+1)},
+                                    detail::recv_message(comm, b, c).m_handle});
                             }
                         }
                     }
                 });
             }
 
-            void pack(communicator_type& comm)
+            void pack(exchange_state& st, communicator_type& comm)
             {
-                detail::for_each(m_mem, [this,&comm](auto& m)
-                {
-                    using arch_type = typename std::remove_reference_t<decltype(m)>::arch_type;
-                    packer<arch_type>::pack(m,m_send_futures,comm);
+                detail::for_each(st.m_mem, [this,&st,&comm](auto& m) 
+                { 
+                    pack_buffers(m, st.m_send_futures, comm, m_thread_pool); 
                 });
             }
 
+            // thread pool for unpacking an exchange, if its messages may be unpacked concurrently
+            thread_pool* unpack_pool(const exchange_state& st) const noexcept
+            {
+                return st.m_serial_unpack ? nullptr : m_thread_pool;
+            }
+
+            // start the global reduction attached to this exchange
+            void start_reduction(exchange_state& st, const communicator_type& comm)
+            {
+                if (!m_next_reduction) return;
+                st.m_reduction = m_next_reduction(comm);
+                m_next_reduction = nullptr;
+            }
+
         private: // wait functions
 
-            void wait()
+            void wait(exchange_state& st)
             {
-                if (!m_valid) return;
-                detail::for_each(m_mem, [this](auto& m)
-                {
-                    using arch_type = typename std::remove_reference_t<decltype(m)>::arch_type;
-                    packer<arch_type>::unpack(m);
+                if (!st.m_valid) return;
+                detail::for_each(st.m_mem, [this,&st](auto& m) { unpack_buffers(m, unpack_pool(st)); });
+                finish(st);
+            }
+
+            // unpack serially in the order of arrival and notify about completed neighbors
+            void wait(exchange_state& st, const neighbor_function_type& f)
+            {
+                if (!st.m_valid) return;
+                detail::for_each(st.m_mem, [&f](auto& m) { unpack_each(m, f); });
+                finish(st);
+            }
+
+            // unpack the messages holding halos of a field in the order of arrival; the exchange is completed by a
+            // later wait or test
+            void wait_field(exchange_state& st, const void* field_ptr)
+            {
+                if (!st.m_valid) return;
+                detail::for_each(st.m_mem, [&st,field_ptr](auto& m) { check_separate(m, field_ptr, st.m_chunk_size); });
+                detail::for_each(st.m_mem, [field_ptr](auto& m) { unpack_field(m, field_ptr); });
+            }
+
+            // whether a message holds halos of a field
+            template<typename Hook>
+            static bool holds(const Hook& hook, const void* field_ptr)
+            {
+                for (std::size_t i=hook.m_first; i<hook.m_last; ++i)
+                    if (hook->field_infos[i].field_ptr == field_ptr) return true;
+                return false;
+            }
+
+            // notify about receive buffers which have been unpacked completely by wait_field
+            template<typename Memory>
+            static void notify_unpacked(Memory& m, const neighbor_function_type& f)
+            {
+                for (auto& p0 : m.recv_memory)
+                    for (auto& p1 : p0.second)
+                    {
+                        auto& b = p1.second;
+                        if (b.local || b.field_infos.empty() || b.num_unpacked < b.field_infos.size()) continue;
+                        b.num_unpacked = 0u;
+                        f(b.ids.first_id, b.ids.second_id);
+                    }
+            }
+
+            // reset the counts of unpacked field infos after an exchange
+            template<typename Memory>
+            static void reset_unpacked(Memory& m)
+            {
+                for (auto& p0 : m.recv_memory)
+                    for (auto& p1 : p0.second)
+                        p1.second.num_unpacked = 0u;
+            }
+
+            // call f once all field infos of a receive buffer have been unpacked (the count is reset for the 
+            // next exchange)
+            template<typename Hook>
+            static void notify(const Hook& hook, const neighbor_function_type& f)
+            {
+                auto& b = *hook.m_buffer;
+                b.num_unpacked += hook.m_last - hook.m_first;
+                if (b.num_unpacked < b.field_infos.size()) return;
+                b.num_unpacked = 0u;
+                f(b.ids.first_id, b.ids.second_id);
+            }
+
+            // unpack arrived messages and check for completion without blocking
+            bool test(exchange_state& st)
+            {
+                if (!st.m_valid) return true;
+                bool done = true;
+                detail::for_each(st.m_mem, [this,&st,&done](auto& m) 
+                { 
+                    done = progress_buffers(m, unpack_pool(st)) && done; 
                 });
-                for (auto& f : m_send_futures) 
+                if (!done) return false;
+                if (!st.m_reduction.test()) return false;
+                if (!m_double_buffering)
+                    for (auto& f : st.m_send_futures) 
+                        if (!f.test()) return false;
+                for (auto& f : st.m_draining) 
+                    if (!f.test()) return false;
+                finish(st);
+                return true;
+            }
+
+            // complete an exchange whose receives have been unpacked: await its reduction and its sends, or, with
+            // double buffering, the sends of the previous exchange and swap the buffer sets
+            void finish(exchange_state& st)
+            {
+                st.m_reduction.wait();
+                for (auto& v : st.m_versions)
+                    m_field_versions[std::move(v.first)] = v.second;
+                st.m_versions.clear();
+                drain(st);
+                if (m_double_buffering)
+                {
+                    std::swap(st.m_draining, st.m_send_futures);
+                    clear(st);
+                    std::swap(st.m_mem, st.m_spare_mem);
+                }
+                else
+                {
+                    for (auto& f : st.m_send_futures) 
+                        f.wait();
+                    clear(st);
+                }
+            }
+
+            // await the sends from the spare buffer set
+            static void drain(exchange_state& st)
+            {
+                for (auto& f : st.m_draining) 
                     f.wait();
-                clear();
+                st.m_draining.clear();
             }
 
 #ifdef __CUDACC__
             template<typename T, typename Field>
-            void wait_u()
+            void wait_u(exchange_state& st)
             {
-                if (!m_valid) return;
+                if (!st.m_valid) return;
                 using memory_t   = buffer_memory<gpu>;
-                memory_t& mem = std::get<memory_t>(m_mem);
+                memory_t& mem = std::get<memory_t>(st.m_mem);
                 packer<gpu>::template unpack_u<T,Field>(mem);
-                for (auto& f : m_send_futures) 
-                    f.wait();
-                clear();
+                finish(st);
             }
 #endif
         
+        private: // operations on the buffer memory of one device (also used by exchange plans)
+
+            // copy the halos of the local buffer pairs, using the thread pool if given
+            template<typename Memory>
+            static void copy_local_pairs(Memory& m, thread_pool* pool)
+            {
+                if (pool)
+                {
+                    std::vector<std::future<void>> tasks;
+                    tasks.reserve(m.m_local_pairs.size());
+                    for (auto& p : m.m_local_pairs)
+                        tasks.push_back(pool->submit([p](){ copy_local(*p.first, *p.second); }));
+                    for (auto& t : tasks) t.get();
+                }
+                else
+                    for (auto& p : m.m_local_pairs)
+                        copy_local(*p.first, *p.second);
+            }
+
+            // pack the send buffers and send them through comm, using the thread pool if given
+            template<typename Memory, typename Futures, typename Comm>
+            static void pack_buffers(Memory& m, Futures& send_futures, Comm& comm, thread_pool* pool)
+            {
+                using arch_type = typename Memory::arch_type;
+                if (pool)
+                    packer<arch_type>::pack(m,send_futures,comm,*pool);
+                else
+                    packer<arch_type>::pack(m,send_futures,comm);
+            }
+
+            // unpack all messages, using the thread pool if given
+            template<typename Memory>
+            static void unpack_buffers(Memory& m, thread_pool* pool)
+            {
+                using arch_type = typename Memory::arch_type;
+                if (pool)
+                    packer<arch_type>::unpack(m,*pool);
+                else
+                    packer<arch_type>::unpack(m);
+            }
+
+            // unpack the messages which have arrived without blocking; returns true if all have been unpacked
+            template<typename Memory>
+            static bool progress_buffers(Memory& m, thread_pool* pool)
+            {
+                using arch_type = typename Memory::arch_type;
+                return pool ? packer<arch_type>::progress(m,*pool) : packer<arch_type>::progress(m);
+            }
+
+            // unpack serially in the order of arrival and notify about completed neighbors, starting with the
+            // local ones and those completed by wait_field
+            template<typename Memory>
+            static void unpack_each(Memory& m, const neighbor_function_type& f)
+            {
+                using arch_type = typename Memory::arch_type;
+                for (const auto& p : m.m_local_pairs)
+                    f(p.second->ids.first_id, p.second->ids.second_id);
+                notify_unpacked(m, f);
+                packer<arch_type>::unpack_each(m, [&f](const auto& hook) { notify(hook, f); });
+            }
+
+            // throw if the halos of a field are received in an unsplit buffer together with other fields, which 
+            // happens without chunking and for packers which do not support chunks (see wait_field)
+            template<typename Memory>
+            static void check_separate(const Memory& m, const void* field_ptr, std::size_t chunk_size)
+            {
+                using arch_type = typename Memory::arch_type;
+                if (chunk_size > 0u && packer<arch_type>::supports_chunks) return;
+                auto of_field = [field_ptr](const auto& fi) { return fi.field_ptr == field_ptr; };
+                for (const auto& p0 : m.recv_memory)
+                    for (const auto& p1 : p0.second)
+                    {
+                        const auto& fis = p1.second.field_infos;
+                        if (p1.second.local || std::none_of(fis.begin(), fis.end(), of_field) || 
+                            std::all_of(fis.begin(), fis.end(), of_field))
+                            continue;
+                        throw std::runtime_error(
+                            "wait_field requires the fields of an exchange to be sent in separate messages: set a chunk size");
+                    }
+            }
+
+            // unpack the messages holding halos of a field in the order of arrival
+            template<typename Memory>
+            static void unpack_field(Memory& m, const void* field_ptr)
+            {
+                using arch_type = typename Memory::arch_type;
+                packer<arch_type>::unpack_selected(m, 
+                    [field_ptr](const auto& hook) { return holds(hook, field_ptr); },
+                    [](const auto& hook) { hook->num_unpacked += hook.m_last - hook.m_first; });
+            }
+
         private: // reset
 
             // clear the internal flags so that a new exchange can be started
             // important: does not deallocate
-            void clear()
+            void clear(exchange_state& st)
             {
-                m_valid = false;
-                m_send_futures.clear();
-                detail::for_each(m_mem, [this](auto& m)
+                st.m_valid = false;
+                st.m_serial_unpack = false;
+                st.m_send_futures.clear();
+                st.m_versions.clear();
+                detail::for_each(st.m_mem, [](auto& m)
                 {
                     m.m_recv_futures.clear();
+                    m.m_local_pairs.clear();
                     for (auto& p0 : m.send_memory)
                         for (auto& p1 : p0.second)
                         {
                             p1.second.buffer.resize(0);
                             p1.second.size = 0;
                             p1.second.field_infos.resize(0);
+                            p1.second.chunks.resize(0);
+                            p1.second.local = false;
                         }
                     for (auto& p0 : m.recv_memory)
                         for (auto& p1 : p0.second)
@@ -430,6 +1691,9 @@ namespace gridtools {
                             p1.second.buffer.resize(0);
                             p1.second.size = 0;
                             p1.second.field_infos.resize(0);
+                            p1.second.chunks.resize(0);
+                            p1.second.local = false;
+                            p1.second.num_unpacked = 0u;
                         }
                 });
             }
@@ -437,7 +1701,8 @@ namespace gridtools {
         private: // allocation member functions
 
             template<typename Arch, typename T, typename Memory, typename Field, typename O>
-            void allocate(Memory& mem, const pattern_type& pattern, Field* field_ptr, domain_id_type dom_id, typename arch_traits<Arch>::device_id_type device_id, O tag_offset)
+            void allocate(forward_direction, Memory& mem, const pattern_type& pattern, Field* field_ptr, domain_id_type dom_id, typename arch_traits<Arch>::device_id_type device_id, O tag_offset,
+                          bool use_datatype, const std::vector<int>& depth, const std::vector<bool>& directions)
             {
                 auto& pool = mem->m_pools[device_id];
                 if (!pool)
@@ -446,7 +1711,7 @@ namespace gridtools {
                 }
                 allocate<Arch,T,typename buffer_memory<Arch>::recv_buffer_type>( 
                     mem->recv_memory[device_id], 
-                    pattern.recv_halos(),
+                    clipped_halos(pattern.recv_halos(), depth, directions),
                     [field_ptr](const void* buffer, const index_container_type& c, void* arg) 
                     {
                         field_ptr->unpack(reinterpret_cast<const T*>(buffer),c,arg); 
@@ -456,10 +1721,52 @@ namespace gridtools {
                     tag_offset, 
                     true, 
                     *pool,
-                    field_ptr);
+                    field_ptr,
+                    use_datatype);
+                allocate<Arch,T,typename buffer_memory<Arch>::send_buffer_type>(
+                    mem->send_memory[device_id], 
+                    clipped_halos(pattern.send_halos(), depth, directions),
+                    [field_ptr](void* buffer, const index_container_type& c, void* arg) 
+                    {
+                        field_ptr->pack(reinterpret_cast<T*>(buffer),c,arg);
+                    },
+                    dom_id, 
+                    device_id, 
+                    tag_offset, 
+                    false, 
+                    *pool, 
+                    field_ptr,
+                    use_datatype);
+            }
+
+            // reverse direction: the halo regions are packed and sent to their owners, which combine them with the
+            // values of their send regions; derived datatypes are not used
+            template<typename Arch, typename T, typename Memory, typename Field, typename O, typename Op>
+            void allocate(const reverse_direction<Op>& dir, Memory& mem, const pattern_type& pattern, Field* field_ptr, domain_id_type dom_id, typename arch_traits<Arch>::device_id_type device_id, O tag_offset,
+                          bool, const std::vector<int>& depth, const std::vector<bool>& directions)
+            {
+                auto& pool = mem->m_pools[device_id];
+                if (!pool)
+                {
+                    pool.reset( new typename arch_traits<Arch>::pool_type{ typename arch_traits<Arch>::basic_allocator_type{} } );
+                }
+                // passed as lvalue, such that it is copied into each field info
+                auto unpack_fct = detail::make_accumulate<unpack_function_type,T,index_container_type>(field_ptr, dir.op, 0);
+                allocate<Arch,T,typename buffer_memory<Arch>::recv_buffer_type>( 
+                    mem->recv_memory[device_id], 
+                    clipped_halos(pattern.send_halos(), depth, directions),
+                    unpack_fct,
+                    dom_id, 
+                    device_id, 
+                    tag_offset, 
+                    true, 
+                    *pool,
+                    field_ptr,
+                    false,
+                    true);
                 allocate<Arch,T,typename buffer_memory<Arch>::send_buffer_type>(
                     mem->send_memory[device_id], 
-                    pattern.send_halos(),
+                    clipped_halos(pattern.recv_halos(), depth, directions),
                     [field_ptr](void* buffer, const index_container_type& c, void* arg) 
                     {
                         field_ptr->pack(reinterpret_cast<T*>(buffer),c,arg);
@@ -469,16 +1776,34 @@ namespace gridtools {
                     tag_offset, 
                     false, 
                     *pool, 
-                    field_ptr);
+                    field_ptr,
+                    false,
+                    true);
+            }
+
+            // the pattern's halos (not owned), or the halos clipped to the given depth and directions
+            static std::shared_ptr<const map_type> clipped_halos(const map_type& m, const std::vector<int>& depth,
+                const std::vector<bool>& directions)
+            {
+                if (depth.empty() && directions.empty()) 
+                    return std::shared_ptr<const map_type>(std::shared_ptr<const map_type>(), &m);
+                auto clipped = std::make_shared<map_type>();
+                for (const auto& p : m)
+                    clipped->emplace(p.first, detail::clip_halos(p.second, depth, directions, 0));
+                return clipped;
             }
 
             // compute memory requirements to be allocated on the device
             template<typename Arch, typename ValueType, typename BufferType, typename Memory, typename Halos, typename Function, typename DeviceIdType, 
                 typename Pool, typename Field = void>
-            void allocate(Memory& memory, const Halos& halos, Function&& func, domain_id_type my_dom_id, DeviceIdType device_id, 
-                          int tag_offset, bool receive, Pool& pool, Field* field_ptr = nullptr)
+            void allocate(Memory& memory, const std::shared_ptr<const Halos>& halos, Function&& func, domain_id_type my_dom_id, DeviceIdType device_id, 
+                          int tag_offset, bool receive, Pool& pool, Field* field_ptr = nullptr, bool use_datatype = false,
+                          bool accumulate = false)
             {
-                for (const auto& p_id_c : halos)
+                using datatype_type = typename communicator_type::datatype;
+                if (use_datatype && !packer<Arch>::supports_chunks)
+                    throw std::runtime_error("derived datatypes are not supported on this device");
+                for (const auto& p_id_c : *halos)
                 {
                     const auto num_elements   = pattern_type::num_elements(p_id_c.second);
                     if (num_elements < 1) continue;
@@ -503,28 +1828,49 @@ namespace gridtools {
                             d_p,
                             BufferType{
                                 remote_address,
-                                p_id_c.first.tag+tag_offset,
+                                p_id_c.first.tag*tag_stride()+tag_offset,
                                 arch_traits<Arch>::make_message(pool, device_id),
                                 0,
                                 std::vector<typename BufferType::field_info_type>(),
-                                cuda::stream()
+                                cuda::stream(),
+                                std::vector<std::size_t>(),
+                                false,
+                                d_p,
+                                0u
                             })).first;
                     }
                     else if (it->second.size==0)
                     {
                         it->second.address = remote_address;
-                        it->second.tag = p_id_c.first.tag+tag_offset;
+                        it->second.tag = p_id_c.first.tag*tag_stride()+tag_offset;
                         it->second.field_infos.resize(0);
                     }
                     const auto prev_size = it->second.size;
                     const auto padding = ((prev_size+alignof(ValueType)-1)/alignof(ValueType))*alignof(ValueType) - prev_size;
+                    const auto size = static_cast<std::size_t>(num_elements)*sizeof(ValueType);
+                    // accumulated values are always unpacked, and never copied directly between fields
+                    // with double buffering, sends must not refer to field memory (see set_double_buffering)
+                    void* zero_copy_ptr = (packer<Arch>::supports_zero_copy && !use_datatype && !(accumulate && receive) &&
+                        (receive || !m_double_buffering)) ? 
+                        detail::contiguous_data(field_ptr, p_id_c.second, 0) : nullptr;
+                    auto type = use_datatype ? 
+                        detail::field_datatype<datatype_type>(field_ptr, p_id_c.second, 0) : std::shared_ptr<const datatype_type>();
+                    auto local_copy = (packer<Arch>::supports_local_copy && !accumulate) ? 
+                        detail::make_local_copy<local_copy_function_type>(field_ptr, p_id_c.second, 0) : local_copy_function_type();
+                    auto split = packer<Arch>::supports_chunks ? 
+                        detail::make_split<split_function_type>(field_ptr, p_id_c.second, 0) : split_function_type();
                     it->second.field_infos.push_back(
-                        typename BufferType::field_info_type{std::forward<Function>(func), &p_id_c.second, prev_size + padding, field_ptr});
-                    it->second.size += padding + static_cast<std::size_t>(num_elements)*sizeof(ValueType);
+                        typename BufferType::field_info_type{std::forward<Function>(func), &p_id_c.second, prev_size + padding, 
+                            field_ptr, size, zero_copy_ptr, std::move(type), std::move(local_copy), 
+                            &detail::field_type_id<Field>::value, halos, std::move(split)});
+                    it->second.size += padding + size;
                 }
             }
         };
 
+        template<typename Transport, typename GridType, typename DomainIdType>
+        constexpr int communication_object<Transport,GridType,DomainIdType>::num_tag_slots;
+
         /** @brief creates a communication object based on the pattern type
           * @tparam PatternContainer pattern type
           * @return communication object */
@@ -537,6 +1883,33 @@ namespace gridtools {
             return communication_object<transport_type,grid_type,domain_id_type>();
         }
 
+        /** @brief creates a communication object with a user defined id based on the pattern type
+          * @tparam PatternContainer pattern type
+          * @param id id between 0 and num_tag_slots-1, which determines the tag range of the communication object
+          * @return communication object */
+        template<typename PatternContainer>
+        auto make_communication_object(int id)
+        {
+            using transport_type    = typename PatternContainer::value_type::communicator_type::transport_type;
+            using grid_type        = typename PatternContainer::value_type::grid_type;
+            using domain_id_type   = typename PatternContainer::value_type::domain_id_type;
+            return communication_object<transport_type,grid_type,domain_id_type>(id);
+        }
+
+        /** @brief creates a communication object with an automatically assigned id based on the pattern type 
+          * (collective, see communication_object::communication_object(auto_id_t, const communicator_type&))
+          * @tparam PatternContainer pattern type
+          * @param comm communicator of the patterns
+          * @return communication object */
+        template<typename PatternContainer>
+        auto make_communication_object(auto_id_t, const typename PatternContainer::value_type::communicator_type& comm)
+        {
+            using transport_type    = typename PatternContainer::value_type::communicator_type::transport_type;
+            using grid_type        = typename PatternContainer::value_type::grid_type;
+            using domain_id_type   = typename PatternContainer::value_type::domain_id_type;
+            return communication_object<transport_type,grid_type,domain_id_type>(auto_id, comm);
+        }
+
     } // namespace ghex
         
 } // namespace gridtools
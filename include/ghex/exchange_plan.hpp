@@ -0,0 +1,643 @@
+/* 
+ * GridTools
+ * 
+ * Copyright (c) 2014-2019, ETH Zurich
+ * All rights reserved.
+ * 
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ * 
+ */
+#ifndef INCLUDED_GHEX_EXCHANGE_PLAN_HPP
+#define INCLUDED_GHEX_EXCHANGE_PLAN_HPP
+
+#include "./cuda_utils/stream.hpp"
+#include "./packer.hpp"
+#include "./node_aggregation.hpp"
+#include "./common/utils.hpp"
+#include "./common/thread_pool.hpp"
+#include "./transport_layer/mpi/node_topology.hpp"
+#include "./arch_traits.hpp"
+#include <map>
+#include <memory>
+#include <functional>
+#include <tuple>
+#include <vector>
+#include <algorithm>
+
+namespace gridtools {
+
+    namespace ghex {
+
+        // forward declaration
+        template<typename Transport, typename GridType, typename DomainIdType>
+        class communication_handle;
+
+        // forward declaration
+        template<typename Transport, typename GridType, typename DomainIdType>
+        class communication_object;
+
+        /** @brief A compiled exchange of a fixed set of fields, created through communication_object::make_plan.
+          * The plan owns its buffers, which are allocated once at construction. Tags, addresses, buffer sizes,
+          * offsets and pack/unpack callbacks are frozen in flat arrays, so that repeated exchanges only need to
+          * post the receives, pack, send and unpack. Since the buffers never move, all messages are bound to 
+          * persistent requests at construction, which are merely started in each exchange. Halos exchanged 
+          * between domains on this rank are copied directly. If node aggregation is enabled, the messages to other
+          * nodes are laid out in a shared window of the node at construction and are transmitted by the node
+          * leader (see communication_object::set_node_aggregation): the leader sends once all ranks of the node
+          * have packed, which is detected without blocking while the leader waits for or tests the exchange.
+          * Note, that the fields and patterns used to create the plan must outlive it.
+          * @tparam Transport message transport type
+          * @tparam GridType grid tag type
+          * @tparam DomainIdType domain id type*/
+        template<typename Transport, typename GridType, typename DomainIdType>
+        class exchange_plan
+        {
+        private: // friend class
+
+            friend class communication_object<Transport,GridType,DomainIdType>;
+
+        public: // member types
+
+            /** @brief handle type returned by execute */
+            using handle_type             = communication_handle<Transport,GridType,DomainIdType>;
+
+        private: // member types
+
+            using co_type                 = communication_object<Transport,GridType,DomainIdType>;
+            using communicator_type       = typename handle_type::communicator_type;
+            using address_type            = typename communicator_type::address_type;
+            using neighbor_function_type  = typename handle_type::neighbor_function_type;
+            using persistent_request      = typename communicator_type::persistent_request;
+            using domain_id_pair          = typename co_type::domain_id_pair;
+
+            /** @brief message which owns the persistent send requests bound to its memory (one for each message
+              * the buffer is transmitted in)
+              * @tparam Message message type */
+            template<typename Message>
+            struct persistent_message : public Message
+            {
+                std::vector<persistent_request> m_requests;
+                persistent_message(Message&& msg) : Message(std::move(msg)) {}
+                persistent_message(persistent_message&&) = default;
+            };
+
+            /** @brief communicator interface for the packer, which starts the persistent send requests instead 
+              * of posting new sends */
+            struct persistent_sender
+            {
+                communicator_type& m_comm;
+
+                // whole buffers sent by packers which do not support chunks
+                template<typename Message>
+                typename communicator_type::template future<void> send(Message& msg, address_type, int) const
+                {
+                    return m_comm.start(msg.m_requests[0]);
+                }
+
+                // c-th message of a buffer (see detail::send_message)
+                template<typename Buffer>
+                typename communicator_type::template future<void> send_message(Buffer& b, std::size_t c) const
+                {
+                    return m_comm.start(b.buffer.m_requests[c]);
+                }
+            };
+
+            /** @brief Holds flat arrays of send and receive buffers indexed by a device id
+              * @tparam Arch the device on which the buffer memory is allocated */
+            template<typename Arch>
+            struct plan_memory
+            {
+                using arch_type        = Arch;
+                using device_id_type   = typename arch_traits<Arch>::device_id_type;
+                using pool_type        = typename arch_traits<Arch>::pool_type;
+                using co_memory_type   = typename co_type::template buffer_memory<Arch>;
+                using vector_type      = typename co_memory_type::vector_type;
+
+                using send_buffer_type = typename co_type::template buffer<persistent_message<vector_type>,typename co_type::pack_function_type>;
+                using recv_buffer_type = typename co_memory_type::recv_buffer_type;
+                using send_memory_type = std::vector<std::pair<device_id_type, std::vector<std::pair<domain_id_pair,send_buffer_type>>>>;
+                using recv_memory_type = std::vector<std::pair<device_id_type, std::vector<std::pair<domain_id_pair,recv_buffer_type>>>>;
+
+                std::vector<std::pair<device_id_type, std::unique_ptr<pool_type>>> m_pools;
+                send_memory_type send_memory;
+                recv_memory_type recv_memory;
+
+                // additional members needed for receive operations used for scheduling calls to unpack
+                using hook_type       = typename co_type::template buffer_hook<recv_buffer_type>;
+                using future_type     = typename communicator_type::template future<hook_type>;
+                std::vector<future_type> m_recv_futures;
+                // persistent receive requests of all messages, and the field infos they hold; the first 
+                // m_num_prepost requests receive into plan buffers and may be posted ahead of an execution
+                std::vector<persistent_request> m_recv_requests;
+                std::vector<hook_type> m_recv_hooks;
+                std::size_t m_num_prepost = 0u;
+                // matching send and receive buffers between domains on this rank
+                std::vector<std::pair<send_buffer_type*, recv_buffer_type*>> m_local_pairs;
+                // messages to and from other nodes, if they are aggregated
+                using aggregator_type = node_aggregator<communicator_type,send_buffer_type,recv_buffer_type>;
+                std::unique_ptr<aggregator_type> m_aggregator;
+            };
+
+            /** tuple type of plan_memory (one element for each device in arch_list) */
+            using memory_type = detail::transform<arch_list>::with<plan_memory>;
+
+        private: // members
+
+            communicator_type m_comm;
+            bool m_valid;
+            memory_type m_mem;
+            std::vector<typename communicator_type::template future<void>> m_send_futures;
+            thread_pool* m_thread_pool;
+            std::shared_ptr<tl::mpi::node_topology> m_topology;
+            int m_agg_tag;
+            bool m_prepost = false;
+            bool m_preposted = false;
+            int m_halo_width = 0;
+            int m_valid_depth = 0;
+            // global reduction to be started by the next execution, and the one in progress
+            std::function<typename communicator_type::template future<void>(const communicator_type&)> m_next_reduction;
+            typename communicator_type::template future<void> m_reduction;
+
+        private: // private constructor called by communication_object
+
+            /** @brief freeze the buffer layout computed by a communication object
+              * @param comm communicator
+              * @param co_mem buffer memory of the communication object (filled but not yet posted)
+              * @param pool optional thread pool for packing and unpacking
+              * @param topology node topology if messages between nodes are aggregated, nullptr otherwise
+              * @param agg_tag tag of the aggregated messages */
+            exchange_plan(const communicator_type& comm, typename co_type::memory_type& co_mem, thread_pool* pool,
+                std::shared_ptr<tl::mpi::node_topology> topology = nullptr, int agg_tag = 0)
+            : m_comm{comm}, m_valid{false}, m_thread_pool{pool}, m_topology{std::move(topology)}, m_agg_tag{agg_tag}
+            {
+                // the halo width defaults to the number of layers received in all directions which have halos
+                std::map<int,int> depth;
+                detail::for_each(co_mem, [&depth](const auto& m)
+                {
+                    for (const auto& p0 : m.recv_memory)
+                        for (const auto& p1 : p0.second)
+                            for (const auto& fi : p1.second.field_infos)
+                                add_layers(*fi.index_container, depth, 0);
+                });
+                if (!depth.empty()) m_halo_width = depth.begin()->second;
+                for (const auto& d : depth)
+                    m_halo_width = std::min(m_halo_width, d.second);
+                std::size_t num_sends = 0u;
+                detail::for_each(m_mem, [this,&num_sends,&co_mem](auto& m)
+                {
+                    using memory_t  = std::remove_reference_t<decltype(m)>;
+                    using arch_type = typename memory_t::arch_type;
+                    using pool_type = typename memory_t::pool_type;
+                    const auto& co_m = std::get<typename memory_t::co_memory_type>(co_mem);
+                    std::map<typename memory_t::device_id_type, pool_type*> pools;
+                    auto get_pool = [&m,&pools](typename memory_t::device_id_type device_id) -> pool_type&
+                    {
+                        auto& pool = pools[device_id];
+                        if (!pool)
+                        {
+                            m.m_pools.emplace_back(device_id, 
+                                std::unique_ptr<pool_type>{ new pool_type{ typename arch_traits<arch_type>::basic_allocator_type{} } });
+                            pool = m.m_pools.back().second.get();
+                        }
+                        return *pool;
+                    };
+                    for (const auto& p0 : co_m.send_memory)
+                        num_sends += freeze<arch_type>(get_pool, p0.first, p0.second, m.send_memory);
+                    std::size_t num_recvs = 0u;
+                    for (const auto& p0 : co_m.recv_memory)
+                        num_recvs += freeze<arch_type>(get_pool, p0.first, p0.second, m.recv_memory);
+                    if (m_topology && packer<arch_type>::supports_aggregation)
+                    {
+                        m.m_aggregator.reset(new typename memory_t::aggregator_type(m_comm, m_topology, m_agg_tag, 
+                            m.send_memory, m.recv_memory));
+                        num_recvs -= m.m_aggregator->num_recvs();
+                    }
+                    m.m_recv_futures.reserve(num_recvs);
+                    // bind the final buffers (or the field memory of zero-copy and typed messages) to persistent
+                    // requests
+                    for (auto& p0 : m.send_memory)
+                        for (auto& p1 : p0.second)
+                        {
+                            auto& b = p1.second;
+                            if (b.local) continue;
+                            const std::size_t n = detail::num_messages(b);
+                            b.buffer.m_requests.reserve(n);
+                            for (std::size_t c=0; c<n; ++c)
+                                b.buffer.m_requests.push_back(send_init(b, c));
+                        }
+                    m.m_recv_requests.reserve(num_recvs);
+                    m.m_recv_hooks.reserve(num_recvs);
+                    // buffers received into plan memory only come first, then the ones with messages received 
+                    // into field memory; the messages of a buffer share a tag and are kept in order
+                    auto packed = [](const auto& b)
+                    {
+                        for (std::size_t c=0; c<detail::num_messages(b); ++c)
+                            if (!detail::is_packed(b, detail::first_field(b, c), detail::first_field(b, c+1))) 
+                                return false;
+                        return true;
+                    };
+                    for (int pass=0; pass<2; ++pass)
+                        for (auto& p0 : m.recv_memory)
+                            for (auto& p1 : p0.second)
+                            {
+                                auto& b = p1.second;
+                                if (b.local || packed(b) != (pass == 0)) continue;
+                                const std::size_t n = detail::num_messages(b);
+                                for (std::size_t c=0; c<n; ++c)
+                                {
+                                    m.m_recv_requests.push_back(recv_init(b, c));
+                                    m.m_recv_hooks.push_back({&b, detail::first_field(b, c), detail::first_field(b, c+1)});
+                                }
+                                if (pass == 0) m.m_num_prepost += n;
+                            }
+                    // pair up the local buffers again
+                    for (auto& p0 : m.send_memory)
+                        for (auto& p1 : p0.second)
+                        {
+                            if (!p1.second.local) continue;
+                            for (auto& r0 : m.recv_memory)
+                                if (r0.first == p0.first)
+                                    for (auto& r1 : r0.second)
+                                        if (!(r1.first < p1.first) && !(p1.first < r1.first))
+                                            m.m_local_pairs.emplace_back(&p1.second, &r1.second);
+                        }
+                });
+                m_send_futures.reserve(num_sends);
+            }
+
+        public: // copy and move ctors
+
+            exchange_plan(const exchange_plan&) = delete;
+            exchange_plan(exchange_plan&&) = default;
+            exchange_plan& operator=(const exchange_plan&) = delete;
+            exchange_plan& operator=(exchange_plan&& other)
+            {
+                cancel_preposted();
+                // swapped, such that the old buffers are destroyed with other, before their pools
+                std::swap(m_mem, other.m_mem);
+                std::swap(m_send_futures, other.m_send_futures);
+                m_comm         = std::move(other.m_comm);
+                m_valid        = other.m_valid;
+                m_thread_pool  = other.m_thread_pool;
+                m_topology     = std::move(other.m_topology);
+                m_agg_tag      = other.m_agg_tag;
+                m_prepost      = other.m_prepost;
+                m_preposted    = other.m_preposted;
+                m_halo_width   = other.m_halo_width;
+                m_valid_depth  = other.m_valid_depth;
+                m_next_reduction = std::move(other.m_next_reduction);
+                m_reduction    = std::move(other.m_reduction);
+                other.m_preposted = false;
+                return *this;
+            }
+            ~exchange_plan()
+            {
+                cancel_preposted();
+            }
+
+        public: // configuration
+
+            /** @brief post the receives of the next execution as soon as the current one has been unpacked (and
+              * right away if no execution is in progress). Receives are then usually posted before the neighbors
+              * send, and messages need not be buffered by the MPI library as unexpected messages. Only receives 
+              * into the plan's buffers are posted ahead: receives directly into field memory (zero-copy or 
+              * derived datatypes) and aggregated messages are still posted on execution, since the halos may be
+              * read until then. While receives are posted ahead, no other exchange may use the same tags (e.g.
+              * exchanges of the same patterns through the communication object which created this plan).
+              * Disabling cancels the receives posted ahead; before the tags are used otherwise, all ranks must 
+              * have disabled it (e.g. synchronize with a barrier), since a neighbor's message might be matched
+              * by a receive posted ahead otherwise. The same applies when the plan is destroyed.
+              * @param flag whether to post receives ahead (default false) */
+            void set_prepost(bool flag)
+            {
+                m_prepost = flag;
+                if (!m_prepost) 
+                    cancel_preposted();
+                else if (!m_valid && !m_preposted) 
+                    prepost();
+            }
+
+            /** @return whether receives are posted ahead */
+            bool prepost_enabled() const noexcept { return m_prepost; }
+
+            /** @brief set the number of valid halo layers after an execution, which is used to track valid halo 
+              * layers for communication avoiding deep halos. The patterns of the plan are built with halos of 
+              * width k*r for a stencil of radius r, and the halos are only exchanged every k steps: each step 
+              * calls require(r), which exchanges if fewer than r layers are valid, computes the domain extended by
+              * valid_depth()-r layers (redundantly with the neighbors), and then calls consume(r). The width 
+              * defaults to the smallest number of layers received in any direction with halos (structured 
+              * grids). No layers are valid until the first execution, and only executions of this plan are 
+              * tracked, i.e. exchanges of the same fields through a communication object do not count.
+              * @param width number of halo layers exchanged in all directions */
+            void set_halo_width(int width)
+            {
+                if (width < 0) throw std::runtime_error("halo width must not be negative");
+                m_halo_width  = width;
+                m_valid_depth = 0;
+            }
+
+            /** @return number of halo layers exchanged (see set_halo_width) */
+            int halo_width() const noexcept { return m_halo_width; }
+
+            /** @return number of halo layers which are still valid */
+            int valid_depth() const noexcept { return m_valid_depth; }
+
+        public: // member functions
+
+            /** @brief blocking variant of the planned halo exchange */
+            void bexecute()
+            {
+                execute().wait();
+            }
+
+            /** @brief attach a global reduction to the next execution, which is started right after the halos 
+              * have been sent and completed along with the exchange (see communication_object::allreduce). Throws
+              * if a reduction is already attached to the next execution.
+              * @tparam T arithmetic type
+              * @param send_buf values contributed by this rank (may equal recv_buf for an in-place reduction)
+              * @param recv_buf reduced values
+              * @param count number of values
+              * @param op reduction operation, e.g. MPI_SUM */
+            template<typename T>
+            void allreduce(const T* send_buf, T* recv_buf, int count, MPI_Op op)
+            {
+                if (m_next_reduction)
+                    throw std::runtime_error("a reduction is already attached to the next execution");
+                m_next_reduction = [send_buf,recv_buf,count,op](const communicator_type& comm)
+                { 
+                    return comm.allreduce(send_buf, recv_buf, count, op); 
+                };
+            }
+
+            /** @brief mark halo layers as invalid, e.g. after a stencil application which updated the fields
+              * @param layers number of layers consumed */
+            void consume(int layers)
+            {
+                if (layers < 0) throw std::runtime_error("number of consumed layers must not be negative");
+                m_valid_depth = std::max(0, m_valid_depth-layers);
+            }
+
+            /** @brief exchange the halos (blocking) if fewer than the required layers are valid
+              * @param layers number of valid layers required
+              * @return whether the halos were exchanged */
+            bool require(int layers)
+            {
+                if (layers > m_halo_width) 
+                    throw std::runtime_error("required halo layers exceed the halo width");
+                if (m_valid_depth >= layers) return false;
+                bexecute();
+                return true;
+            }
+
+            /** @brief non-blocking planned exchange of halo data
+              * @return handle to await communication */
+            [[nodiscard]] handle_type execute()
+            {
+                if (m_valid) 
+                    throw std::runtime_error("earlier exchange operation was not finished");
+                m_valid = true;
+                m_valid_depth = m_halo_width;
+                post_recvs();
+                pack();
+                if (m_next_reduction)
+                {
+                    m_reduction = m_next_reduction(m_comm);
+                    m_next_reduction = nullptr;
+                }
+                copy_local();
+                send_aggregated();
+                handle_type h(m_comm, [this](){this->wait();}, [this](){return this->test();});
+                h.m_wait_neighbor_fct = [this](const neighbor_function_type& f){ this->wait(f); };
+                // aggregated messages are only complete once the whole node has received them
+                if (!m_topology)
+                    h.m_wait_field_fct = [this](const void* field_ptr){ this->wait_field(field_ptr); };
+                return h;
+            }
+
+        private: // implementation
+
+            // deepest halo layer per direction (dim0_dir-, dim0_dir+, ...) of structured halos
+            template<typename IndexContainer>
+            static auto add_layers(const IndexContainer& c, std::map<int,int>& depth, int)
+                -> decltype(c.begin()->layers(), void())
+            {
+                for (const auto& is : c)
+                    for (int d=0; d<static_cast<int>(is.layers().first().size()); ++d)
+                    {
+                        if (is.layers().first()[d] < 0) 
+                            depth[2*d] = std::max(depth[2*d], static_cast<int>(-is.layers().first()[d]));
+                        if (is.layers().last()[d] > 0) 
+                            depth[2*d+1] = std::max(depth[2*d+1], static_cast<int>(is.layers().last()[d]));
+                    }
+            }
+
+            // other grids do not number their halo layers
+            template<typename IndexContainer>
+            static void add_layers(const IndexContainer&, std::map<int,int>&, long) {}
+
+            // copy the meta data (including the partition into messages) of all non-empty buffers of one device 
+            // and allocate buffer memory of final size
+            template<typename Arch, typename GetPool, typename DeviceIdType, typename Map, typename Memory>
+            static std::size_t freeze(GetPool& get_pool, DeviceIdType device_id, const Map& map, Memory& memory)
+            {
+                using buffer_type = typename Memory::value_type::second_type::value_type::second_type;
+                using vector_type = decltype(buffer_type::buffer);
+                std::size_t num_buffers = 0u;
+                for (const auto& p1 : map)
+                    if (p1.second.size > 0u) ++num_buffers;
+                if (num_buffers == 0u) return 0u;
+                auto& pool = get_pool(device_id);
+                memory.emplace_back(device_id, std::vector<std::pair<domain_id_pair,buffer_type>>{});
+                auto& buffers = memory.back().second;
+                buffers.reserve(num_buffers);
+                for (const auto& p1 : map)
+                {
+                    if (p1.second.size == 0u) continue;
+                    buffers.emplace_back(p1.first, buffer_type{
+                        p1.second.address,
+                        p1.second.tag,
+                        vector_type{arch_traits<Arch>::make_message(pool, device_id)},
+                        p1.second.size,
+                        p1.second.field_infos,
+                        cuda::stream(),
+                        p1.second.chunks,
+                        p1.second.local,
+                        p1.second.ids,
+                        0u});
+                    if (!p1.second.local)
+                        buffers.back().second.buffer.resize(p1.second.size);
+                }
+                return num_buffers;
+            }
+
+            // bind the c-th message of a send buffer to a persistent request (see detail::send_message)
+            template<typename Buffer>
+            persistent_request send_init(Buffer& b, std::size_t c) const
+            {
+                const auto first = detail::first_field(b, c);
+                const auto last  = detail::first_field(b, c+1);
+                if (detail::is_typed(b, first, last))
+                    return m_comm.send_init(*b.field_infos[first].datatype, b.address, b.tag);
+                if (first == 0u && last == b.field_infos.size() && !detail::is_zero_copy(b, first, last))
+                    return m_comm.send_init(b.buffer, b.address, b.tag);
+                return m_comm.send_init(detail::make_message_view(b, first, last), b.address, b.tag);
+            }
+
+            // bind the c-th message of a receive buffer to a persistent request (see detail::recv_message)
+            template<typename Buffer>
+            persistent_request recv_init(Buffer& b, std::size_t c) const
+            {
+                const auto first = detail::first_field(b, c);
+                const auto last  = detail::first_field(b, c+1);
+                if (detail::is_typed(b, first, last))
+                    return m_comm.recv_init(*b.field_infos[first].datatype, b.address, b.tag);
+                if (first == 0u && last == b.field_infos.size() && !detail::is_zero_copy(b, first, last))
+                    return m_comm.recv_init(b.buffer, b.address, b.tag);
+                auto view = detail::make_message_view(b, first, last);
+                return m_comm.recv_init(view, b.address, b.tag);
+            }
+
+            void post_recvs()
+            {
+                detail::for_each(m_mem, [this](auto& m)
+                {
+                    using future_type = typename std::remove_reference_t<decltype(m)>::future_type;
+                    using hook_type   = typename std::remove_reference_t<decltype(m)>::hook_type;
+                    const std::size_t first = m_preposted ? m.m_num_prepost : 0u;
+                    m_comm.start_all(m.m_recv_requests.data() + first, m.m_recv_requests.size() - first);
+                    for (std::size_t k=0; k<m.m_recv_requests.size(); ++k)
+                        m.m_recv_futures.emplace_back(future_type{hook_type(m.m_recv_hooks[k]), m.m_recv_requests[k].get_request()});
+                });
+                m_preposted = false;
+            }
+
+            // post the receives into plan buffers of the next execution
+            void prepost()
+            {
+                detail::for_each(m_mem, [this](auto& m)
+                {
+                    m_comm.start_all(m.m_recv_requests.data(), m.m_num_prepost);
+                });
+                m_preposted = true;
+            }
+
+            // cancel the receives posted ahead (bounded by the number of requests, which are gone if this plan 
+            // has been moved from)
+            void cancel_preposted()
+            {
+                if (!m_preposted) return;
+                detail::for_each(m_mem, [](auto& m)
+                {
+                    const std::size_t n = std::min(m.m_num_prepost, m.m_recv_requests.size());
+                    for (std::size_t k=0; k<n; ++k)
+                    {
+                        GHEX_CHECK_MPI_RESULT(MPI_Cancel(&m.m_recv_requests[k].get()));
+                        m.m_recv_requests[k].get_request().wait();
+                    }
+                });
+                m_preposted = false;
+            }
+
+            void copy_local()
+            {
+                detail::for_each(m_mem, [this](auto& m) { co_type::copy_local_pairs(m, m_thread_pool); });
+            }
+
+            void pack()
+            {
+                persistent_sender sender{m_comm};
+                detail::for_each(m_mem, [this,&sender](auto& m) 
+                { 
+                    co_type::pack_buffers(m, m_send_futures, sender, m_thread_pool); 
+                });
+            }
+
+            // pack the messages to other nodes into the shared window of the node and let the leader send them
+            void send_aggregated()
+            {
+                detail::for_each(m_mem, [](auto& m) { if (m.m_aggregator) m.m_aggregator->start(); });
+            }
+
+            // unpack and wait for sends; buffers are kept for the next execution
+            void wait()
+            {
+                if (!m_valid) return;
+                detail::for_each(m_mem, [this](auto& m) { co_type::unpack_buffers(m, m_thread_pool); });
+                finish(nullptr);
+            }
+
+            // unpack serially in the order of arrival and notify about completed neighbors
+            void wait(const neighbor_function_type& f)
+            {
+                if (!m_valid) return;
+                detail::for_each(m_mem, [&f](auto& m) { co_type::unpack_each(m, f); });
+                finish(&f);
+            }
+
+            // unpack the messages holding halos of a field (see communication_object::wait_field); plans are compiled
+            // without chunks
+            void wait_field(const void* field_ptr)
+            {
+                if (!m_valid) return;
+                detail::for_each(m_mem, [field_ptr](auto& m) { co_type::check_separate(m, field_ptr, 0u); });
+                detail::for_each(m_mem, [field_ptr](auto& m) { co_type::unpack_field(m, field_ptr); });
+            }
+
+            // wait for the reduction, sends and aggregated messages (whose neighbors are notified if f is given), and
+            // prepare the next execution
+            void finish(const neighbor_function_type* f)
+            {
+                m_reduction.wait();
+                for (auto& fut : m_send_futures) 
+                    fut.wait();
+                m_send_futures.clear();
+                detail::for_each(m_mem, [f](auto& m) 
+                { 
+                    if (m.m_aggregator)
+                    {
+                        m.m_aggregator->complete(true);
+                        if (f)
+                            m.m_aggregator->for_each_recv([f](const domain_id_pair& ids) 
+                            { 
+                                (*f)(ids.first_id, ids.second_id); 
+                            });
+                    }
+                    m.m_recv_futures.clear();
+                    co_type::reset_unpacked(m);
+                });
+                m_valid = false;
+                if (m_prepost) prepost();
+            }
+
+            // unpack arrived messages and check for completion without blocking
+            bool test()
+            {
+                if (!m_valid) return true;
+                bool done = true;
+                detail::for_each(m_mem, [this,&done](auto& m) 
+                { 
+                    done = co_type::progress_buffers(m, m_thread_pool) && done; 
+                });
+                if (!done) return false;
+                if (!m_reduction.test()) return false;
+                for (auto& f : m_send_futures) 
+                    if (!f.test()) return false;
+                detail::for_each(m_mem, [&done](auto& m) 
+                { 
+                    if (m.m_aggregator) done = m.m_aggregator->complete(false) && done; 
+                });
+                if (!done) return false;
+                m_send_futures.clear();
+                detail::for_each(m_mem, [](auto& m) { co_type::reset_unpacked(m); });
+                m_valid = false;
+                if (m_prepost) prepost();
+                return true;
+            }
+        };
+
+    } // namespace ghex
+        
+} // namespace gridtools
+
+#endif /* INCLUDED_GHEX_EXCHANGE_PLAN_HPP */
@@ -0,0 +1,283 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2019, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef INCLUDED_GHEX_NODE_AGGREGATION_HPP
+#define INCLUDED_GHEX_NODE_AGGREGATION_HPP
+
+#include "./packer.hpp"
+#include "./transport_layer/mpi/node_topology.hpp"
+#include "./transport_layer/mpi/request.hpp"
+#include <array>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace gridtools {
+
+    namespace ghex {
+
+        /** @brief Aggregates the messages of the ranks of a node to and from other nodes (see
+          * communication_object::set_node_aggregation). The buffers exchanged with ranks on other nodes are moved
+          * out of the buffer memory of an exchange plan and laid out in a shared window of the node: the messages
+          * of all ranks of the node to (from) the same remote node form a contiguous segment, ordered by (source,
+          * destination, tag), which the node leader sends (receives) as one message. The remote node computes the
+          * same order, such that no meta data is exchanged when the messages are transmitted. The node is 
+          * synchronized with non-blocking barriers only: the leader starts sending once all ranks have packed, and 
+          * the ranks unpack once the leader has received. Construction, start and complete are collective over the
+          * ranks of the node.
+          * @tparam Communicator communicator type
+          * @tparam SendBuffer send buffer type
+          * @tparam RecvBuffer receive buffer type */
+        template<typename Communicator, typename SendBuffer, typename RecvBuffer>
+        class node_aggregator
+        {
+        private: // member types
+
+            using persistent_request = typename Communicator::persistent_request;
+            using domain_id_pair     = decltype(std::declval<RecvBuffer&>().ids);
+            using view_type          = detail::message_view<decltype(std::declval<RecvBuffer&>().buffer)>;
+
+            /** @brief message to or from another node, given by its offset in the shared window and its field infos
+              * @tparam FieldInfo field info type */
+            template<typename FieldInfo>
+            struct message
+            {
+                std::size_t offset;
+                std::vector<FieldInfo> field_infos;
+                domain_id_pair ids;
+            };
+
+            /** @brief contiguous range of the shared window exchanged with the leader of another node */
+            struct segment
+            {
+                int leader;
+                std::size_t begin;
+                std::size_t end;
+            };
+
+        private: // members
+
+            Communicator m_comm;
+            std::shared_ptr<tl::mpi::node_topology> m_topology;
+            int m_tag;
+            std::vector<message<typename SendBuffer::field_info_type>> m_sends;
+            std::vector<message<typename RecvBuffer::field_info_type>> m_recvs;
+            std::unique_ptr<tl::mpi::shared_window> m_window;
+            // persistent requests of the node leader (one per remote node)
+            std::vector<persistent_request> m_requests;
+            // barriers after packing (before the leader sends) and after receiving (before unpacking)
+            tl::mpi::request m_send_barrier;
+            tl::mpi::request m_recv_barrier;
+            bool m_sending = false;
+            bool m_recv_barrier_started = false;
+
+        public: // ctors
+
+            /** @brief move the non-local buffers exchanged with ranks on other nodes out of the buffer memory and
+              * lay out their messages in a shared window of the node
+              * @tparam SendMemory flat array of send buffers by device id
+              * @tparam RecvMemory flat array of receive buffers by device id
+              * @param comm communicator
+              * @param topology node topology
+              * @param tag tag of the aggregated messages
+              * @param send_memory send buffers
+              * @param recv_memory receive buffers */
+            template<typename SendMemory, typename RecvMemory>
+            node_aggregator(const Communicator& comm, std::shared_ptr<tl::mpi::node_topology> topology, int tag,
+                SendMemory& send_memory, RecvMemory& recv_memory)
+            : m_comm{comm}, m_topology{std::move(topology)}, m_tag{tag}
+            {
+                std::vector<long long> send_records, recv_records;
+                extract_remote(send_memory, m_sends, send_records, true);
+                extract_remote(recv_memory, m_recvs, recv_records, false);
+                const auto& node_comm = m_topology->node_comm();
+                const auto node_sends = node_allgather(node_comm, send_records);
+                const auto node_recvs = node_allgather(node_comm, recv_records);
+                // the node does not communicate with other nodes (same decision on all ranks of the node)
+                if (node_sends.empty() && node_recvs.empty()) return;
+                std::vector<segment> send_segments, recv_segments;
+                std::size_t size = layout(node_sends, true, 0u, send_records, m_sends, send_segments);
+                size = layout(node_recvs, false, size, recv_records, m_recvs, recv_segments);
+                m_window.reset(new tl::mpi::shared_window(node_comm, size));
+                if (!m_topology->is_leader()) return;
+                using value_type = typename view_type::value_type;
+                m_requests.reserve(recv_segments.size() + send_segments.size());
+                for (const auto& s : recv_segments)
+                {
+                    view_type view{reinterpret_cast<value_type*>(m_window->data() + s.begin), s.end - s.begin};
+                    m_requests.push_back(m_comm.recv_init(view, s.leader, m_tag));
+                }
+                for (const auto& s : send_segments)
+                {
+                    view_type view{reinterpret_cast<value_type*>(m_window->data() + s.begin), s.end - s.begin};
+                    m_requests.push_back(m_comm.send_init(view, s.leader, m_tag));
+                }
+            }
+
+            node_aggregator(const node_aggregator&) = delete;
+            node_aggregator& operator=(const node_aggregator&) = delete;
+
+        public: // member functions
+
+            /** @return number of receive buffers which were moved out of the buffer memory */
+            std::size_t num_recvs() const noexcept { return m_recvs.size(); }
+
+            /** @brief pack the messages to other nodes into the shared window and enter a non-blocking barrier of
+              * the node; the leader sends them as soon as all ranks of the node have packed (see complete) */
+            void start()
+            {
+                if (!m_window) return;
+                for (const auto& msg : m_sends)
+                    for (const auto& fi : msg.field_infos)
+                        fi.call_back(m_window->data() + msg.offset + fi.offset, *fi.index_container, nullptr);
+                m_window->sync();
+                GHEX_CHECK_MPI_RESULT(MPI_Ibarrier(m_topology->node_comm(), &m_send_barrier.get()));
+                m_sending = false;
+                send(false);
+            }
+
+            /** @brief complete the aggregated messages: once all ranks have packed, the leader sends and receives
+              * the messages and completes its requests, then the ranks of the node synchronize and unpack the 
+              * received messages from the shared window
+              * @param blocking whether to wait for completion
+              * @return true if the messages have been unpacked */
+            bool complete(bool blocking)
+            {
+                if (!m_window) return true;
+                if (!send(blocking)) return false;
+                if (!m_recv_barrier_started)
+                {
+                    // completed persistent requests are inactive and test as complete
+                    for (auto& r : m_requests)
+                    {
+                        auto req = r.get_request();
+                        if (blocking) req.wait();
+                        else if (!req.test()) return false;
+                    }
+                    m_window->sync();
+                    GHEX_CHECK_MPI_RESULT(MPI_Ibarrier(m_topology->node_comm(), &m_recv_barrier.get()));
+                    m_recv_barrier_started = true;
+                }
+                if (blocking) m_recv_barrier.wait();
+                else if (!m_recv_barrier.test()) return false;
+                m_recv_barrier_started = false;
+                m_window->sync();
+                for (const auto& msg : m_recvs)
+                    for (const auto& fi : msg.field_infos)
+                        fi.call_back(m_window->data() + msg.offset + fi.offset, *fi.index_container, nullptr);
+                return true;
+            }
+
+            /** @brief call a function with the domain id pair of each received message
+              * @tparam Func function type with signature void(const domain_id_pair&) */
+            template<typename Func>
+            void for_each_recv(Func&& f) const
+            {
+                for (const auto& msg : m_recvs) f(msg.ids);
+            }
+
+        private: // implementation
+
+            // start the requests of the leader once all ranks of the node have packed; returns whether they have 
+            // been started (receives are started along with the sends, since the ranks of the node may still 
+            // unpack the previous messages from the window until then)
+            bool send(bool blocking)
+            {
+                if (m_sending) return true;
+                if (blocking) m_send_barrier.wait();
+                else if (!m_send_barrier.test()) return false;
+                m_window->sync();
+                m_comm.start_all(m_requests.data(), m_requests.size());
+                m_sending = true;
+                return true;
+            }
+
+            // remove the buffers exchanged with ranks on other nodes and record (source, destination, tag, size)
+            // for each of them
+            template<typename BufferMemory, typename Messages>
+            void extract_remote(BufferMemory& memory, Messages& messages, std::vector<long long>& records,
+                bool send) const
+            {
+                using buffers_type = typename BufferMemory::value_type::second_type;
+                const int rank   = m_comm.rank();
+                const int leader = m_topology->leader(rank);
+                for (auto& p0 : memory)
+                {
+                    buffers_type kept;
+                    kept.reserve(p0.second.size());
+                    for (auto& p1 : p0.second)
+                    {
+                        auto& b = p1.second;
+                        if (b.local || m_topology->leader(b.address) == leader)
+                        {
+                            kept.push_back(std::move(p1));
+                            continue;
+                        }
+                        records.insert(records.end(), {send ? rank : b.address, send ? b.address : rank, b.tag,
+                            static_cast<long long>(b.size)});
+                        messages.push_back({0u, std::move(b.field_infos), b.ids});
+                    }
+                    p0.second = std::move(kept);
+                }
+            }
+
+            // gather the records of all ranks of the node
+            static std::vector<long long> node_allgather(const tl::mpi::communicator_base& node_comm,
+                const std::vector<long long>& records)
+            {
+                const int n = static_cast<int>(records.size());
+                std::vector<int> counts(node_comm.size());
+                GHEX_CHECK_MPI_RESULT(MPI_Allgather(&n, 1, MPI_INT, counts.data(), 1, MPI_INT, node_comm));
+                std::vector<int> displs(counts.size(), 0);
+                for (std::size_t i=1; i<counts.size(); ++i) displs[i] = displs[i-1] + counts[i-1];
+                std::vector<long long> result(displs.back() + counts.back());
+                GHEX_CHECK_MPI_RESULT(MPI_Allgatherv(records.data(), n, MPI_LONG_LONG, result.data(),
+                    counts.data(), displs.data(), MPI_LONG_LONG, node_comm));
+                return result;
+            }
+
+            // assign window offsets (aligned to 64 bytes) to the messages of all ranks of the node, grouped into
+            // segments by remote node, starting at offset; returns the end of the region
+            template<typename Messages>
+            std::size_t layout(const std::vector<long long>& node_records, bool send, std::size_t offset,
+                const std::vector<long long>& records, Messages& messages, std::vector<segment>& segments) const
+            {
+                // (remote leader, source, destination, tag)
+                using key_type = std::array<long long,4>;
+                auto key = [this,send](const std::vector<long long>& r, std::size_t i) -> key_type
+                {
+                    return {m_topology->leader(static_cast<int>(send ? r[i+1] : r[i])), r[i], r[i+1], r[i+2]};
+                };
+                auto align = [](std::size_t x) { return (x + 63u) / 64u * 64u; };
+                std::map<key_type, std::size_t> offsets;
+                for (std::size_t i=0; i<node_records.size(); i+=4)
+                    offsets[key(node_records, i)] = static_cast<std::size_t>(node_records[i+3]);
+                for (auto& p : offsets)
+                {
+                    offset = align(offset);
+                    if (segments.empty() || segments.back().leader != p.first[0])
+                        segments.push_back(segment{static_cast<int>(p.first[0]), offset, offset});
+                    const std::size_t size = p.second;
+                    p.second = offset;
+                    offset += size;
+                    segments.back().end = offset;
+                }
+                for (std::size_t i=0; i<messages.size(); ++i)
+                    messages[i].offset = offsets[key(records, 4*i)];
+                return align(offset);
+            }
+        };
+
+    } // namespace ghex
+
+} // namespace gridtools
+
+#endif /* INCLUDED_GHEX_NODE_AGGREGATION_HPP */
@@ -17,43 +17,350 @@
 #include "./cuda_utils/kernel_argument.hpp"
 #include "./cuda_utils/future.hpp"
 #include <gridtools/common/array.hpp>
+#include <algorithm>
+#include <vector>
+#include <future>
 
 namespace gridtools {
 
     namespace ghex {
 
+        namespace detail {
+
+            /** @brief non-owning view of the memory a message is sent from or received into. This is either a
+              * contiguous part of a buffer (when a buffer is transmitted in chunks) or, for zero-copy messages, the
+              * halo region in field memory.
+              * @tparam Message message type */
+            template<typename Message>
+            struct message_view
+            {
+                using value_type = typename Message::value_type;
+                value_type* m_data;
+                std::size_t m_size;
+                value_type* data() const noexcept { return m_data; }
+                std::size_t size() const noexcept { return m_size; }
+            };
+
+            /** @brief number of messages a buffer is transmitted in */
+            template<typename Buffer>
+            std::size_t num_messages(const Buffer& b) noexcept
+            {
+                return b.chunks.empty() ? 1u : b.chunks.size()-1u;
+            }
+
+            /** @brief index of the first field info of the c-th message of a buffer (c may be num_messages) */
+            template<typename Buffer>
+            std::size_t first_field(const Buffer& b, std::size_t c) noexcept
+            {
+                return b.chunks.empty() ? (c == 0u ? 0u : b.field_infos.size()) : b.chunks[c];
+            }
+
+            /** @brief test whether the field infos [first, last) of a buffer are transmitted without packing, i.e.
+              * whether they consist of a single field info whose halo region is contiguous in field memory
+              * @tparam Buffer buffer type
+              * @param b buffer
+              * @param first index of first field info
+              * @param last index past the last field info
+              * @return true if the message is sent from / received into field memory directly */
+            template<typename Buffer>
+            bool is_zero_copy(const Buffer& b, std::size_t first, std::size_t last) noexcept
+            {
+                return (last == first+1u) && (b.field_infos[first].zero_copy_ptr != nullptr);
+            }
+
+            /** @brief test whether the field infos [first, last) of a buffer consist of a single field info which
+              * is transmitted with a derived datatype
+              * @tparam Buffer buffer type
+              * @param b buffer
+              * @param first index of first field info
+              * @param last index past the last field info
+              * @return true if the message is described by a datatype */
+            template<typename Buffer>
+            bool is_typed(const Buffer& b, std::size_t first, std::size_t last) noexcept
+            {
+                return (last == first+1u) && static_cast<bool>(b.field_infos[first].datatype);
+            }
+
+            /** @brief test whether the field infos [first, last) of a buffer need to be packed and unpacked */
+            template<typename Buffer>
+            bool is_packed(const Buffer& b, std::size_t first, std::size_t last) noexcept
+            {
+                return !is_zero_copy(b, first, last) && !is_typed(b, first, last);
+            }
+
+            /** @brief make a view of the message holding the field infos [first, last) of a buffer. The message
+              * spans from the first field's offset to the end of the last field's data.
+              * @tparam Buffer buffer type
+              * @param b buffer
+              * @param first index of first field info
+              * @param last index past the last field info
+              * @return message view */
+            template<typename Buffer>
+            auto make_message_view(Buffer& b, std::size_t first, std::size_t last)
+            {
+                using message_type = std::remove_reference_t<decltype(b.buffer)>;
+                using view_type    = message_view<message_type>;
+                using value_type   = typename view_type::value_type;
+                const auto& fi = b.field_infos[last-1];
+                if (is_zero_copy(b, first, last))
+                    return view_type{ reinterpret_cast<value_type*>(fi.zero_copy_ptr), fi.size };
+                const std::size_t begin = b.field_infos[first].offset;
+                return view_type{ b.buffer.data() + begin, fi.offset + fi.size - begin };
+            }
+
+            // communicators which have bound their messages beforehand (see exchange_plan) start them instead
+            template<typename Communicator, typename Buffer>
+            auto send_message(Communicator& comm, Buffer& b, std::size_t c, int) -> decltype(comm.send_message(b, c))
+            {
+                return comm.send_message(b, c);
+            }
+
+            /** @brief send the c-th message of a send buffer: a whole buffer, a chunk of it, a zero-copy view of
+              * field memory or a message described by a datatype */
+            template<typename Communicator, typename Buffer>
+            auto send_message(Communicator& comm, Buffer& b, std::size_t c, long)
+            {
+                const auto first = first_field(b, c);
+                const auto last  = first_field(b, c+1);
+                if (is_typed(b, first, last))
+                    return comm.send(*b.field_infos[first].datatype, b.address, b.tag);
+                if (first == 0u && last == b.field_infos.size() && !is_zero_copy(b, first, last))
+                    return comm.send(b.buffer, b.address, b.tag);
+                return comm.send(make_message_view(b, first, last), b.address, b.tag);
+            }
+
+            /** @brief post the receive of the c-th message of a receive buffer (see send_message) */
+            template<typename Communicator, typename Buffer>
+            auto recv_message(Communicator& comm, Buffer& b, std::size_t c)
+            {
+                const auto first = first_field(b, c);
+                const auto last  = first_field(b, c+1);
+                if (is_typed(b, first, last))
+                    return comm.recv(*b.field_infos[first].datatype, b.address, b.tag);
+                if (first == 0u && last == b.field_infos.size() && !is_zero_copy(b, first, last))
+                    return comm.recv(b.buffer, b.address, b.tag);
+                auto view = make_message_view(b, first, last);
+                return comm.recv(view, b.address, b.tag);
+            }
+
+        } // namespace detail
+
         /** @brief generic implementation of pack and unpack */
         template<typename Arch>
         struct packer
         {
+            /** @brief whether buffers may be transmitted in several chunks */
+            static constexpr bool supports_chunks = true;
+            /** @brief whether contiguous halo regions may be transmitted from / into field memory directly */
+            static constexpr bool supports_zero_copy = true;
+            /** @brief whether halos exchanged between domains on the same rank may be copied on the host */
+            static constexpr bool supports_local_copy = true;
+            /** @brief whether messages to other nodes may be aggregated in shared memory by the node leader */
+            static constexpr bool supports_aggregation = true;
+
+            /** @brief pack all send buffers and send them. Neighbors are scheduled by descending message size, 
+              * and chunked buffers are sent chunk by chunk as soon as each chunk is packed. Zero-copy messages
+              * and messages described by derived datatypes are sent from field memory without packing. */
             template<typename Map, typename Futures, typename Communicator>
             static void pack(Map& map, Futures& send_futures,Communicator& comm)
             {
-                for (auto& p0 : map.send_memory)
+                for (auto b : sorted_send_buffers(map))
                 {
-                    for (auto& p1: p0.second)
+                    const std::size_t n = detail::num_messages(*b);
+                    for (std::size_t c=0; c<n; ++c)
                     {
-                        if (p1.second.size > 0u)
+                        const auto first = detail::first_field(*b, c);
+                        const auto last  = detail::first_field(*b, c+1);
+                        if (detail::is_packed(*b, first, last))
+                            pack_fields(*b, first, last);
+                        send_futures.push_back(detail::send_message(comm, *b, c, 0));
+                    }
+                }
+            }
+
+            /** @brief pack all send buffers concurrently using an executor and send them from the calling thread 
+              * as soon as each buffer (or chunk) is packed. Chunks of the same buffer are sent in order.
+              * @tparam Executor executor type (see thread_pool) */
+            template<typename Map, typename Futures, typename Communicator, typename Executor>
+            static void pack(Map& map, Futures& send_futures, Communicator& comm, Executor& executor)
+            {
+                using send_buffer_type = typename Map::send_buffer_type;
+                struct task
+                {
+                    send_buffer_type* b;
+                    std::size_t num_chunks;
+                    std::size_t next;
+                    std::vector<std::future<void>> futures;
+                };
+                std::vector<task> tasks;
+                for (auto b : sorted_send_buffers(map))
+                {
+                    const std::size_t n = detail::num_messages(*b);
+                    tasks.push_back(task{b, n, 0u, {}});
+                    tasks.back().futures.reserve(n);
+                    for (std::size_t c=0; c<n; ++c)
+                    {
+                        const auto first = detail::first_field(*b, c);
+                        const auto last  = detail::first_field(*b, c+1);
+                        if (!detail::is_packed(*b, first, last))
                         {
-                            p1.second.buffer.resize(p1.second.size);
-                            for (const auto& fb : p1.second.field_infos)
-                                fb.call_back( p1.second.buffer.data() + fb.offset, *fb.index_container, nullptr);
-                            send_futures.push_back(comm.send(p1.second.buffer, p1.second.address, p1.second.tag));
+                            // nothing to pack
+                            std::promise<void> p;
+                            p.set_value();
+                            tasks.back().futures.push_back(p.get_future());
                         }
+                        else
+                            tasks.back().futures.push_back(
+                                executor.submit([b,first,last](){ pack_fields(*b, first, last); }));
                     }
                 }
+                std::size_t remaining = tasks.size();
+                while (remaining > 0u)
+                {
+                    bool sent = false;
+                    for (auto& t : tasks)
+                    {
+                        if (t.next == t.num_chunks) continue;
+                        while (t.next < t.num_chunks && Executor::ready(t.futures[t.next]))
+                        {
+                            t.futures[t.next].get();
+                            send_futures.push_back(detail::send_message(comm, *t.b, t.next, 0));
+                            ++t.next;
+                            sent = true;
+                        }
+                        if (t.next == t.num_chunks) --remaining;
+                    }
+                    // nothing was ready: block on the oldest pending chunk instead of spinning, such that the 
+                    // calling thread does not compete with the workers
+                    if (!sent && remaining > 0u)
+                        for (auto& t : tasks)
+                            if (t.next < t.num_chunks)
+                            {
+                                t.futures[t.next].wait();
+                                break;
+                            }
+                }
             }
 
             template<typename BufferMem>
             static void unpack(BufferMem& m)
             {
-                await_futures(
-                    m.m_recv_futures,
-                    [](typename BufferMem::hook_type hook)
+                await_futures(m.m_recv_futures, unpack_hook<typename BufferMem::hook_type>);
+            }
+
+            /** @brief unpack concurrently using an executor: arrived messages are handed to the executor, and
+              * this function returns when all messages have been unpacked
+              * @tparam Executor executor type (see thread_pool) */
+            template<typename BufferMem, typename Executor>
+            static void unpack(BufferMem& m, Executor& executor)
+            {
+                using hook_type = typename BufferMem::hook_type;
+                std::vector<std::future<void>> tasks;
+                tasks.reserve(m.m_recv_futures.size());
+                await_futures(m.m_recv_futures, [&tasks,&executor](hook_type hook)
+                {
+                    tasks.push_back(executor.submit([hook](){ unpack_hook(hook); }));
+                });
+                for (auto& t : tasks) t.get();
+            }
+
+            /** @brief unpack all messages which have arrived so far without blocking
+              * @return true if all messages have been unpacked */
+            template<typename BufferMem>
+            static bool progress(BufferMem& m)
+            {
+                return progress_futures(m.m_recv_futures, unpack_hook<typename BufferMem::hook_type>);
+            }
+
+            /** @brief unpack all messages which have arrived so far concurrently using an executor. Does not 
+              * block on the network, but waits for the unpack tasks of the arrived messages.
+              * @tparam Executor executor type (see thread_pool)
+              * @return true if all messages have been unpacked */
+            template<typename BufferMem, typename Executor>
+            static bool progress(BufferMem& m, Executor& executor)
+            {
+                using hook_type = typename BufferMem::hook_type;
+                std::vector<std::future<void>> tasks;
+                const bool done = progress_futures(m.m_recv_futures, [&tasks,&executor](hook_type hook)
+                {
+                    tasks.push_back(executor.submit([hook](){ unpack_hook(hook); }));
+                });
+                for (auto& t : tasks) t.get();
+                return done;
+            }
+
+            /** @brief unpack in the order of arrival, and call a function after each message has been unpacked
+              * @tparam Function function type taking the hook of the unpacked message */
+            template<typename BufferMem, typename Function>
+            static void unpack_each(BufferMem& m, Function&& f)
+            {
+                await_futures(m.m_recv_futures, [&f](typename BufferMem::hook_type hook)
+                {
+                    unpack_hook(hook);
+                    f(hook);
+                });
+            }
+
+            /** @brief unpack the messages whose hook satisfies a predicate in the order of arrival, and call a 
+              * function after each of them has been unpacked; the other messages are left for later
+              * @tparam Predicate predicate type taking a hook
+              * @tparam Function function type taking the hook of the unpacked message */
+            template<typename BufferMem, typename Predicate, typename Function>
+            static void unpack_selected(BufferMem& m, Predicate&& p, Function&& f)
+            {
+                auto selected = extract_futures(m.m_recv_futures, std::forward<Predicate>(p));
+                await_futures(selected, [&f](typename BufferMem::hook_type hook)
+                {
+                    unpack_hook(hook);
+                    f(hook);
+                });
+            }
+
+        private:
+
+            // collect all non-empty send buffers which are not copied locally, ordered by descending size
+            template<typename Map>
+            static std::vector<typename Map::send_buffer_type*> sorted_send_buffers(Map& map)
+            {
+                using send_buffer_type = typename Map::send_buffer_type;
+                std::vector<send_buffer_type*> buffers;
+                for (auto& p0 : map.send_memory)
+                {
+                    for (auto& p1: p0.second)
                     {
-                        for (const auto& fb :  hook->field_infos)
-                            fb.call_back(hook->buffer.data() + fb.offset, *fb.index_container, nullptr);
-                    });
+                        if (p1.second.size > 0u && !p1.second.local)
+                        {
+                            p1.second.buffer.resize(p1.second.size);
+                            buffers.push_back(&p1.second);
+                        }
+                    }
+                }
+                std::stable_sort(buffers.begin(), buffers.end(), 
+                    [](const send_buffer_type* a, const send_buffer_type* b) { return a->size > b->size; });
+                return buffers;
+            }
+
+            // pack the fields [first, last) of a send buffer
+            template<typename Buffer>
+            static void pack_fields(Buffer& b, std::size_t first, std::size_t last)
+            {
+                for (std::size_t i=first; i<last; ++i)
+                {
+                    const auto& fb = b.field_infos[i];
+                    fb.call_back( b.buffer.data() + fb.offset, *fb.index_container, nullptr);
+                }
+            }
+
+            // unpack the fields of a received message (zero-copy and typed messages have arrived in field memory)
+            template<typename Hook>
+            static void unpack_hook(Hook hook)
+            {
+                if (!detail::is_packed(*hook.m_buffer, hook.m_first, hook.m_last)) return;
+                for (std::size_t i=hook.m_first; i<hook.m_last; ++i)
+                {
+                    const auto& fb = hook->field_infos[i];
+                    fb.call_back(hook->buffer.data() + fb.offset, *fb.index_container, nullptr);
+                }
             }
         };
 
@@ -118,6 +425,34 @@ namespace gridtools {
         template<>
         struct packer<gpu>
         {
+            /** @brief buffers are always transmitted as a whole */
+            static constexpr bool supports_chunks = false;
+            /** @brief halo regions are always packed */
+            static constexpr bool supports_zero_copy = false;
+            /** @brief halos are always sent, also between domains on the same rank */
+            static constexpr bool supports_local_copy = false;
+            /** @brief buffers live in device memory and are always sent by their owner */
+            static constexpr bool supports_aggregation = false;
+
+            // packing is done by cuda kernels, an executor is not used
+            template<typename Map, typename Futures, typename Communicator, typename Executor>
+            static void pack(Map& map, Futures& send_futures, Communicator& comm, Executor&)
+            {
+                pack(map, send_futures, comm);
+            }
+
+            template<typename BufferMem, typename Executor>
+            static void unpack(BufferMem& m, Executor&)
+            {
+                unpack(m);
+            }
+
+            template<typename BufferMem, typename Executor>
+            static bool progress(BufferMem& m, Executor&)
+            {
+                return progress(m);
+            }
+
             template<typename Map, typename Futures, typename Communicator>
             static void pack(Map& map, Futures& send_futures,Communicator& comm)
             {
@@ -182,6 +517,68 @@ namespace gridtools {
                 }
             }
 
+            /** @brief unpack in the order of arrival, and call a function after each message has been unpacked
+              * and its stream has been synchronized
+              * @tparam Function function type taking the hook of the unpacked message */
+            template<typename BufferMem, typename Function>
+            static void unpack_each(BufferMem& m, Function&& f)
+            {
+                // the continuation of a message runs as soon as it has been unpacked, before the remaining
+                // messages are awaited
+                await_futures(
+                    m.m_recv_futures,
+                    [&f](typename BufferMem::hook_type hook)
+                    {
+                        auto stream_ptr = &hook->m_cuda_stream.get();
+                        for (const auto& fb : hook->field_infos)
+                                fb.call_back(hook->buffer.data() + fb.offset, *fb.index_container, (void*)(stream_ptr));
+                        cudaStreamSynchronize(*stream_ptr);
+                        f(hook);
+                    });
+            }
+
+            /** @brief unpack the messages whose hook satisfies a predicate, and call a function after each of them
+              * has been unpacked and its stream has been synchronized; the other messages are left for later
+              * @tparam Predicate predicate type taking a hook
+              * @tparam Function function type taking the hook of the unpacked message */
+            template<typename BufferMem, typename Predicate, typename Function>
+            static void unpack_selected(BufferMem& m, Predicate&& p, Function&& f)
+            {
+                auto selected = extract_futures(m.m_recv_futures, std::forward<Predicate>(p));
+                await_futures(
+                    selected,
+                    [&f](typename BufferMem::hook_type hook)
+                    {
+                        auto stream_ptr = &hook->m_cuda_stream.get();
+                        for (const auto& fb : hook->field_infos)
+                                fb.call_back(hook->buffer.data() + fb.offset, *fb.index_container, (void*)(stream_ptr));
+                        cudaStreamSynchronize(*stream_ptr);
+                        f(hook);
+                    });
+            }
+
+            /** @brief unpack all messages which have arrived so far without blocking on the network
+              * @return true if all messages have been unpacked */
+            template<typename BufferMem>
+            static bool progress(BufferMem& m)
+            {
+                std::vector<cudaStream_t*> stream_ptrs;
+                const bool done = progress_futures(
+                    m.m_recv_futures,
+                    [&stream_ptrs](typename BufferMem::hook_type hook)
+                    {
+                        auto stream_ptr = &hook->m_cuda_stream.get();
+                        for (const auto& fb : hook->field_infos)
+                                fb.call_back(hook->buffer.data() + fb.offset, *fb.index_container, (void*)(stream_ptr));
+                        stream_ptrs.push_back(stream_ptr);
+                    });
+                for (auto x : stream_ptrs) 
+                {
+                    cudaStreamSynchronize(*x);
+                }
+                return done;
+            }
+
             template<typename T, typename FieldType, typename Map, typename Futures, typename Communicator>
             static void pack_u(Map& map, Futures& send_futures, Communicator& comm)
             {
@@ -14,6 +14,8 @@
 #include "./transport_layer/mpi/setup.hpp"
 #include "./transport_layer/mpi/communicator.hpp"
 #include "./buffer_info.hpp"
+#include <vector>
+#include <iterator>
 
 namespace gridtools {
 
@@ -48,7 +50,13 @@ namespace gridtools {
 
         public: // copy constructor
             pattern_container(const pattern_container&) noexcept = delete;
-            pattern_container(pattern_container&&) noexcept = default;
+            pattern_container(pattern_container&& other) noexcept 
+            : m_patterns(std::move(other.m_patterns)), m_max_tag(other.m_max_tag)
+            {
+                // the patterns refer back to their container
+                for (auto& p : m_patterns)
+                    p.m_container = this;
+            }
 
         private: // private constructor called through make_pattern
             pattern_container(data_type&& d, int mt) noexcept : m_patterns(d), m_max_tag(mt) 
@@ -77,6 +85,23 @@ namespace gridtools {
                 throw std::runtime_error("field incompatible with available domains!");
             }
 
+            /** @brief bind a batch of structurally identical fields (e.g. the members of an ensemble) to the 
+             * patterns. Exchanged through the vector interface of a communication object (or a plan made from it),
+             * the halos of all fields bound to the same pattern are transmitted in one message per neighbor, 
+             * ordered by field (member-major), unless buffers are split into chunks.
+             * @tparam FieldRange range of fields of the same type
+             * @param fields range of field instances
+             * @return lightweight buffer_info objects, one per field. Attention: hold references to fields and patterns! */
+            template<typename FieldRange>
+            auto batch(FieldRange& fields) const
+            {
+                using field_type = std::remove_reference_t<decltype(*std::begin(fields))>;
+                std::vector<buffer_info<value_type,typename field_type::arch_type,field_type>> result;
+                for (auto& f : fields)
+                    result.push_back((*this)(f));
+                return result;
+            }
+
         private: // members
             data_type m_patterns;
             int m_max_tag;
@@ -0,0 +1,88 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2019, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef INCLUDED_GHEX_STRUCTURED_DATATYPE_HPP
+#define INCLUDED_GHEX_STRUCTURED_DATATYPE_HPP
+
+#include "./simple_field_wrapper.hpp"
+#include "../transport_layer/mpi/datatype.hpp"
+#include <vector>
+
+namespace gridtools {
+namespace ghex {
+namespace structured {
+
+    /** @brief create a derived datatype describing the halo region given by a set of iteration spaces directly
+     * in the memory of a field. Each iteration space is described by nested strided vectors, with the stride-1
+     * dimension innermost, and the iteration spaces are combined at their absolute addresses. Hence the type
+     * signature is identical to the serialized form produced by pack, and a message sent with this type may be
+     * received into a packed buffer and vice versa. Byte strides are used throughout, such that padded fields
+     * are supported.
+     * @tparam T field value type
+     * @tparam Arch device type the data lives on
+     * @tparam DomainDescriptor domain type
+     * @tparam Order permutation of the set {0,...,N-1} indicating storage layout (N-1 -> stride=1)
+     * @tparam IndexContainer iteration space container type
+     * @param f field
+     * @param c iteration spaces (local coordinates)
+     * @return committed datatype to be used with MPI_BOTTOM */
+    template<typename T, typename Arch, typename DomainDescriptor, int... Order, typename IndexContainer>
+    tl::mpi::datatype make_datatype(const simple_field_wrapper<T,Arch,DomainDescriptor,Order...>& f, const IndexContainer& c)
+    {
+        using field_type      = simple_field_wrapper<T,Arch,DomainDescriptor,Order...>;
+        using dimension       = typename field_type::dimension;
+        using coordinate_type = typename field_type::coordinate_type;
+        const int order[dimension::value] = {Order...};
+        std::vector<MPI_Datatype> types;
+        std::vector<MPI_Aint> displacements;
+        std::vector<int> block_lengths;
+        types.reserve(c.size());
+        displacements.reserve(c.size());
+        block_lengths.reserve(c.size());
+        for (const auto& is : c)
+        {
+            const auto& first = is.local().first();
+            const auto& last  = is.local().last();
+            MPI_Datatype t;
+            GHEX_CHECK_MPI_RESULT(MPI_Type_contiguous(sizeof(T), MPI_BYTE, &t));
+            // nest from the stride-1 dimension outwards
+            for (int l=dimension::value-1; l>=0; --l)
+            {
+                int d = 0;
+                while (order[d] != l) ++d;
+                MPI_Datatype outer;
+                GHEX_CHECK_MPI_RESULT(MPI_Type_create_hvector(last[d]-first[d]+1, 1,
+                    static_cast<MPI_Aint>(f.byte_strides()[d]), t, &outer));
+                GHEX_CHECK_MPI_RESULT(MPI_Type_free(&t));
+                t = outer;
+            }
+            coordinate_type x;
+            for (int d=0; d<dimension::value; ++d) x[d] = first[d];
+            MPI_Aint address;
+            GHEX_CHECK_MPI_RESULT(MPI_Get_address(
+                reinterpret_cast<const char*>(f.data()) + dot(x+f.offsets(), f.byte_strides()), &address));
+            types.push_back(t);
+            displacements.push_back(address);
+            block_lengths.push_back(1);
+        }
+        MPI_Datatype result;
+        GHEX_CHECK_MPI_RESULT(MPI_Type_create_struct(static_cast<int>(types.size()), block_lengths.data(),
+            displacements.data(), types.data(), &result));
+        for (auto& t : types)
+            GHEX_CHECK_MPI_RESULT(MPI_Type_free(&t));
+        return tl::mpi::datatype{result};
+    }
+
+} // namespace structured
+} // namespace ghex
+} // namespace gridtools
+
+#endif /* INCLUDED_GHEX_STRUCTURED_DATATYPE_HPP */
+
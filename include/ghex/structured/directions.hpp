@@ -0,0 +1,92 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2019, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef INCLUDED_GHEX_STRUCTURED_DIRECTIONS_HPP
+#define INCLUDED_GHEX_STRUCTURED_DIRECTIONS_HPP
+
+#include "../common/utils.hpp"
+#include <array>
+#include <vector>
+
+namespace gridtools {
+    namespace ghex {
+        namespace structured {
+
+            /** @brief A direction mask selects the neighbors of a structured domain whose halos are exchanged.
+              * Directions are given by an offset of -1, 0 or 1 per dimension, and are indexed with dimension 0
+              * varying fastest, i.e. the mask has 3^D entries, where the entry of the domain itself (offset 0 in
+              * all dimensions) is ignored. */
+
+            /** @brief index of a direction within a direction mask
+              * @tparam Array coordinate-like type
+              * @param dir offset (-1, 0 or 1) per dimension
+              * @return index */
+            template<typename Array>
+            int direction_index(const Array& dir)
+            {
+                int index = 0;
+                for (int d=static_cast<int>(dir.size())-1; d>=0; --d)
+                    index = 3*index + (dir[d] < 0 ? 0 : (dir[d] > 0 ? 2 : 1));
+                return index;
+            }
+
+            /** @brief create a direction mask from a predicate
+              * @tparam Dimension number of dimensions
+              * @tparam Predicate callable taking a std::array<int,Dimension> of offsets and returning a bool
+              * @param p predicate which is true for the selected directions
+              * @return direction mask */
+            template<int Dimension, typename Predicate>
+            std::vector<bool> make_direction_mask(Predicate&& p)
+            {
+                std::vector<bool> mask(::gridtools::ghex::detail::ct_pow(3,Dimension));
+                for (int i=0; i<static_cast<int>(mask.size()); ++i)
+                {
+                    std::array<int,Dimension> dir;
+                    for (int d=0, j=i; d<Dimension; ++d, j/=3) dir[d] = j%3 - 1;
+                    mask[i] = p(dir);
+                }
+                return mask;
+            }
+
+            /** @brief direction mask selecting the face neighbors (offset in exactly one dimension)
+              * @tparam Dimension number of dimensions
+              * @return direction mask */
+            template<int Dimension>
+            std::vector<bool> face_directions()
+            {
+                return make_direction_mask<Dimension>([](const std::array<int,Dimension>& dir)
+                {
+                    int n = 0;
+                    for (auto x : dir) n += (x != 0);
+                    return n == 1;
+                });
+            }
+
+            /** @brief direction mask selecting the two neighbors along one dimension
+              * @tparam Dimension number of dimensions
+              * @param dim dimension
+              * @return direction mask */
+            template<int Dimension>
+            std::vector<bool> axis_directions(int dim)
+            {
+                return make_direction_mask<Dimension>([dim](const std::array<int,Dimension>& dir)
+                {
+                    for (int d=0; d<Dimension; ++d)
+                        if ((d == dim) != (dir[d] != 0)) return false;
+                    return true;
+                });
+            }
+
+        } // namespace structured
+    } // namespace ghex
+} // namespace gridtools
+
+#endif /* INCLUDED_GHEX_STRUCTURED_DIRECTIONS_HPP */
+
@@ -185,6 +185,27 @@ namespace gridtools {
             return halos;
         }
 
+        /** @return halo sizes (dim0_dir-, dim0_dir+, dim1_dir-, dim1_dir+, ...) */
+        const std::array<int,dimension::value*2>& halos() const noexcept { return m_halos; }
+
+        /** @return periodicity per dimension */
+        const std::array<bool,dimension::value>& periodic() const noexcept { return m_periodic; }
+
+        /** @brief halo generator for the faces of one dimension
+         * @param dim dimension
+         * @return copy of this generator with zero halos in all other dimensions */
+        halo_generator faces(int dim) const
+        {
+            halo_generator g(*this);
+            for (int d=0; d<dimension::value; ++d)
+            {
+                if (d == dim) continue;
+                g.m_halos[2*d]   = 0;
+                g.m_halos[2*d+1] = 0;
+            }
+            return g;
+        }
+
     private: // member functions
         template<typename Box, typename Spaces>
         std::vector<Box> compute_spaces(const Spaces& spaces) const
@@ -12,9 +12,13 @@
 #define INCLUDED_GHEX_STRUCTURED_PATTERN_HPP
 
 #include "./grid.hpp"
+#include "./directions.hpp"
 #include "../transport_layer/communicator.hpp"
 #include "../pattern.hpp"
 #include <map>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
 #include <iosfwd>
 
 namespace gridtools {
@@ -90,7 +94,9 @@ namespace gridtools {
         };
 
         // this struct combines local and global representation of a hypercube
-        // and is a compostion of 2 iteration_space objects
+        // and is a compostion of 2 iteration_space objects, together with the position of the hypercube
+        // relative to the receiving domain: per dimension, halo layers below the domain are numbered -1,-2,...
+        // from the domain outwards, layers above the domain 1,2,..., and coordinates within the domain are 0
         struct iteration_space_pair
         {
         public: // member types
@@ -102,11 +108,14 @@ namespace gridtools {
             const iteration_space& local() const noexcept { return m_local; }
             iteration_space& global() noexcept { return m_global; }
             const iteration_space& global() const noexcept { return m_global; }
+            iteration_space& layers() noexcept { return m_layers; }
+            const iteration_space& layers() const noexcept { return m_layers; }
             int size() const noexcept { return m_local.size(); } 
 
         public: // members
             iteration_space m_local;
             iteration_space m_global;
+            iteration_space m_layers;
 
         public: // print
             template< class CharT, class Traits>
@@ -157,6 +166,65 @@ namespace gridtools {
             return s;
         }
 
+        /** @brief restrict halo regions to a number of layers around the receiving domain and to a subset of 
+         * the neighbor directions. Since the layers are stored in both the send and the receive halos, sender
+         * and receiver clip matching regions.
+         * @param c iteration spaces (send or receive halos)
+         * @param depth number of layers per direction (dim0_dir-, dim0_dir+, dim1_dir-, dim1_dir+, ...), or
+         * empty for all layers
+         * @param directions direction mask (see structured::direction_index), or empty for all directions; not
+         * supported for regions spanning several directions (later stages of a staged pattern)
+         * @return clipped iteration spaces; spaces outside the depth or in disabled directions are removed */
+        static index_container_type clip(const index_container_type& c, const std::vector<int>& depth, 
+            const std::vector<bool>& directions = {})
+        {
+            if (!depth.empty() && depth.size() != static_cast<std::size_t>(2*dimension::value))
+                throw std::runtime_error("halo depth requires two values per dimension");
+            if (!directions.empty() && directions.size() != static_cast<std::size_t>(::gridtools::ghex::detail::ct_pow(3,dimension::value)))
+                throw std::runtime_error("direction mask requires 3^dimension entries");
+            index_container_type result;
+            result.reserve(c.size());
+            for (const auto& is : c)
+            {
+                // the sign of the layer numbers gives the direction of the neighbor
+                if (!directions.empty())
+                {
+                    for (int d=0; d<coordinate_type::size(); ++d)
+                        if ((is.layers().first()[d] < 0) != (is.layers().last()[d] < 0) ||
+                            (is.layers().first()[d] > 0) != (is.layers().last()[d] > 0))
+                            throw std::runtime_error("direction masks are not supported for halos spanning several directions");
+                    if (!directions[structured::direction_index(is.layers().first())]) continue;
+                }
+                iteration_space_pair r = is;
+                bool empty = false;
+                for (int d=0; d<coordinate_type::size() && !depth.empty(); ++d)
+                {
+                    const auto first = is.layers().first()[d];
+                    const auto last  = is.layers().last()[d];
+                    // number of points removed at the lower and upper end (regions may span layers on both sides
+                    // of the domain, see make_staged_pattern)
+                    coordinate_element_type lo = 0, hi = 0;
+                    if (first < 0)
+                        lo = std::max<coordinate_element_type>(0, -depth[2*d]-first);
+                    if (last > 0)
+                        hi = std::max<coordinate_element_type>(0, last-depth[2*d+1]);
+                    if (lo+hi > last-first)
+                    {
+                        empty = true;
+                        break;
+                    }
+                    r.local().first()[d]  += lo;
+                    r.global().first()[d] += lo;
+                    r.layers().first()[d] += lo;
+                    r.local().last()[d]   -= hi;
+                    r.global().last()[d]  -= hi;
+                    r.layers().last()[d]  -= hi;
+                }
+                if (!empty) result.push_back(r);
+            }
+            return result;
+        }
+
         friend class pattern_container<Transport,grid_type,DomainIdType>;
 
     private: // members
@@ -190,6 +258,7 @@ namespace gridtools {
         const coordinate_type& global_first() const noexcept { return m_global_first; }
         const coordinate_type& global_last()  const noexcept { return m_global_last; }
         const iteration_space& global_domain() const noexcept { return m_domain.global(); }
+        const iteration_space_pair& domain() const noexcept { return m_domain; }
 
         /** @brief tie pattern to field
          * @tparam Field field type
@@ -243,7 +312,8 @@ namespace gridtools {
                         iteration_space_pair{
                             iteration_space{coordinate_type{d.first()}-coordinate_type{d.first()}, 
                                             coordinate_type{d.last()} -coordinate_type{d.first()}},
-                            iteration_space{coordinate_type{d.first()}, coordinate_type{d.last()}}} );
+                            iteration_space{coordinate_type{d.first()}, coordinate_type{d.last()}},
+                            iteration_space{}} );
                     my_patterns.emplace_back( new_comm, my_domain_extents.back(), my_domain_ids.back() );
                     // make space for more halos
                     my_generated_recv_halos.resize(my_generated_recv_halos.size()+1);
@@ -254,7 +324,8 @@ namespace gridtools {
                     {
                         iteration_space_pair is{
                             iteration_space{coordinate_type{h.local().first()},coordinate_type{h.local().last()}},
-                            iteration_space{coordinate_type{h.global().first()},coordinate_type{h.global().last()}}};
+                            iteration_space{coordinate_type{h.global().first()},coordinate_type{h.global().last()}},
+                            iteration_space{}};
                         // check that invariant is fullfilled (halos are not empty)
                         if (is.local().first() <= is.local().last())
                         {
@@ -318,8 +389,17 @@ namespace gridtools {
                                     // prepare pair of intersection (local and global)
                                     iteration_space h{left, right};
                                     iteration_space hl{leftl, rightl};
+                                    // number the halo layers relative to my domain
+                                    const auto& dom_last = my_domain_extents[i].local().last();
+                                    coordinate_type lf, ll;
+                                    for (int d=0; d<coordinate_type::size(); ++d)
+                                    {
+                                        lf[d] = leftl[d]<0 ? leftl[d] : (leftl[d]>dom_last[d] ? leftl[d]-dom_last[d] : 0);
+                                        ll[d] = rightl[d]<0 ? rightl[d] : (rightl[d]>dom_last[d] ? rightl[d]-dom_last[d] : 0);
+                                    }
                                     // add halo to respective extended domain id key
-                                    my_patterns[i].recv_halos()[domain_id].push_back(iteration_space_pair{hl,h});
+                                    my_patterns[i].recv_halos()[domain_id].push_back(
+                                        iteration_space_pair{hl,h,iteration_space{lf,ll}});
                                 }
                             }
                         }
@@ -572,6 +652,60 @@ namespace gridtools {
 
                 return pattern_container<Transport,grid_type,domain_id_type>(std::move(my_patterns), m_max_tag);
             }
+
+            /** @brief turn the face halos of one dimension into a stage of a dimension-wise exchange (see 
+             * structured::make_staged_pattern): the halo regions are extended by the halos of all previous 
+             * dimensions, which have been filled in the previous stages, such that edges and corners are 
+             * forwarded by the face neighbors. Regions are not extended beyond non-periodic global boundaries.
+             * Collective over the communicator.
+             * @param c patterns of the face halos of dimension dim
+             * @param comm communicator
+             * @param dim dimension of this stage
+             * @param halos halo sizes (dim0_dir-, dim0_dir+, dim1_dir-, dim1_dir+, ...)
+             * @param periodic periodicity per dimension */
+            template<typename Transport, typename DomainIdType, typename Halos, typename Periodic>
+            static void extend_stage(
+                pattern_container<Transport,::gridtools::ghex::structured::detail::grid<CoordinateArrayType>,DomainIdType>& c,
+                MPI_Comm comm, int dim, const Halos& halos, const Periodic& periodic)
+            {
+                using coordinate_type = typename ::gridtools::ghex::structured::detail::grid<CoordinateArrayType>::coordinate_type;
+                bool aligned = true;
+                for (auto& p : c.m_patterns)
+                {
+                    const auto& dom = p.global_domain();
+                    coordinate_type lo, hi;
+                    for (int e=0; e<coordinate_type::size(); ++e)
+                    {
+                        lo[e] = (e < dim && (periodic[e] || dom.first()[e] > p.global_first()[e])) ? halos[2*e]   : 0;
+                        hi[e] = (e < dim && (periodic[e] || dom.last()[e]  < p.global_last()[e]))  ? halos[2*e+1] : 0;
+                    }
+                    auto extend = [&](auto& map)
+                    {
+                        for (auto& id_is : map)
+                            for (auto& is : id_is.second)
+                                for (int e=0; e<dim; ++e)
+                                {
+                                    // the face neighbor must cover the same range in the previous dimensions,
+                                    // such that its halos are the ones needed here
+                                    aligned = aligned && is.local().first()[e] == 0 && 
+                                        is.local().last()[e] == dom.last()[e]-dom.first()[e];
+                                    is.local().first()[e]  -= lo[e];
+                                    is.global().first()[e] -= lo[e];
+                                    is.local().last()[e]   += hi[e];
+                                    is.global().last()[e]  += hi[e];
+                                    // the region now spans the halo layers of the previous dimensions, too
+                                    is.layers().first()[e] = -lo[e];
+                                    is.layers().last()[e]  = hi[e];
+                                }
+                    };
+                    extend(p.send_halos());
+                    extend(p.recv_halos());
+                }
+                int flag = aligned ? 1 : 0;
+                GHEX_CHECK_MPI_RESULT(MPI_Allreduce(MPI_IN_PLACE, &flag, 1, MPI_INT, MPI_LAND, comm));
+                if (!flag)
+                    throw std::runtime_error("dimension-wise exchange requires face neighbors with equal extents in the other dimensions");
+            }
         };
 
     } // namespace detail
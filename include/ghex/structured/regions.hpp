@@ -0,0 +1,142 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2019, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef INCLUDED_GHEX_STRUCTURED_REGIONS_HPP
+#define INCLUDED_GHEX_STRUCTURED_REGIONS_HPP
+
+#include "./pattern.hpp"
+#include <stdexcept>
+#include <vector>
+
+namespace gridtools {
+    namespace ghex {
+        namespace structured {
+
+            /** @brief decomposition of a domain into an interior region, which can be computed with a stencil
+              * of a given radius without accessing any halo points, and disjoint boundary boxes, which depend
+              * on the halos. Together, the boxes cover the domain exactly once. This enables overlapping
+              * computation with communication: start the exchange, compute the interior, wait for the
+              * exchange, compute the boundary.
+              * @tparam Pattern structured pattern type */
+            template<typename Pattern>
+            struct region_decomposition
+            {
+                using iteration_space_pair = typename Pattern::iteration_space_pair;
+                /** interior box (local and global coordinates), empty if the domain is too small */
+                std::vector<iteration_space_pair> interior;
+                /** boundary boxes (local and global coordinates), empty if no halos are received */
+                std::vector<iteration_space_pair> boundary;
+            };
+
+            /** @brief decompose the domain of a pattern into interior and boundary regions. The domain is
+              * only shrunk on sides where halos are received, e.g. non-periodic boundaries of the global
+              * domain belong to the interior.
+              * @tparam Pattern structured pattern type
+              * @param p pattern
+              * @param radius stencil radius per direction (dim0_dir-, dim0_dir+, dim1_dir-, dim1_dir+, ...)
+              * @return interior and boundary boxes */
+            template<typename Pattern>
+            region_decomposition<Pattern> make_regions(const Pattern& p, const std::vector<int>& radius)
+            {
+                using iteration_space_pair    = typename Pattern::iteration_space_pair;
+                using coordinate_element_type = typename Pattern::coordinate_element_type;
+                const int dim = Pattern::dimension::value;
+                if (radius.size() != static_cast<std::size_t>(2*dim))
+                    throw std::runtime_error("stencil radius requires two values per dimension");
+
+                // sides of the domain on which halos are received
+                std::vector<bool> has_halo(2*dim, false);
+                for (const auto& h : p.recv_halos())
+                    for (const auto& is : h.second)
+                        for (int d=0; d<dim; ++d)
+                        {
+                            if (is.layers().first()[d] < 0) has_halo[2*d]   = true;
+                            if (is.layers().last()[d]  > 0) has_halo[2*d+1] = true;
+                        }
+
+                iteration_space_pair domain = p.domain();
+                for (int d=0; d<dim; ++d)
+                {
+                    domain.layers().first()[d] = 0;
+                    domain.layers().last()[d]  = 0;
+                }
+
+                // interior: shrink the domain on all sides with halos
+                iteration_space_pair inner = domain;
+                bool empty = false;
+                for (int d=0; d<dim; ++d)
+                {
+                    const coordinate_element_type lo = has_halo[2*d]   ? radius[2*d]   : 0;
+                    const coordinate_element_type hi = has_halo[2*d+1] ? radius[2*d+1] : 0;
+                    if (lo+hi > domain.local().last()[d]-domain.local().first()[d])
+                    {
+                        empty = true;
+                        break;
+                    }
+                    inner.local().first()[d]  += lo;
+                    inner.global().first()[d] += lo;
+                    inner.local().last()[d]   -= hi;
+                    inner.global().last()[d]  -= hi;
+                }
+
+                region_decomposition<Pattern> result;
+                if (empty)
+                {
+                    result.boundary.push_back(domain);
+                    return result;
+                }
+                result.interior.push_back(inner);
+
+                // boundary: peel off slabs dimension by dimension; slab d spans the interior extent in the
+                // dimensions below d and the full domain extent in the dimensions above d
+                iteration_space_pair rest = domain;
+                for (int d=0; d<dim; ++d)
+                {
+                    const auto lo = inner.local().first()[d]-domain.local().first()[d];
+                    const auto hi = domain.local().last()[d]-inner.local().last()[d];
+                    if (lo > 0)
+                    {
+                        iteration_space_pair slab = rest;
+                        slab.local().last()[d]  = slab.local().first()[d]+lo-1;
+                        slab.global().last()[d] = slab.global().first()[d]+lo-1;
+                        result.boundary.push_back(slab);
+                    }
+                    if (hi > 0)
+                    {
+                        iteration_space_pair slab = rest;
+                        slab.local().first()[d]  = slab.local().last()[d]-hi+1;
+                        slab.global().first()[d] = slab.global().last()[d]-hi+1;
+                        result.boundary.push_back(slab);
+                    }
+                    rest.local().first()[d]  = inner.local().first()[d];
+                    rest.global().first()[d] = inner.global().first()[d];
+                    rest.local().last()[d]   = inner.local().last()[d];
+                    rest.global().last()[d]  = inner.global().last()[d];
+                }
+                return result;
+            }
+
+            /** @brief decompose the domain of a pattern into interior and boundary regions
+              * @tparam Pattern structured pattern type
+              * @param p pattern
+              * @param radius stencil radius in all directions
+              * @return interior and boundary boxes */
+            template<typename Pattern>
+            region_decomposition<Pattern> make_regions(const Pattern& p, int radius)
+            {
+                return make_regions(p, std::vector<int>(2*Pattern::dimension::value, radius));
+            }
+
+        } // namespace structured
+    } // namespace ghex
+} // namespace gridtools
+
+#endif /* INCLUDED_GHEX_STRUCTURED_REGIONS_HPP */
+
@@ -13,8 +13,11 @@
 
 #include "./field_utils.hpp"
 #include "./domain_descriptor.hpp"
+#include <atomic>
 #include <cstring>
 #include <cstdint>
+#include <vector>
+#include <algorithm>
 #include <gridtools/common/array.hpp>
 #include "../arch_traits.hpp"
 
@@ -88,6 +91,15 @@ namespace structured {
     }
 #endif
 
+    namespace detail {
+        // process-wide unique id of a wrapped field (see simple_field_wrapper::id)
+        inline std::size_t next_field_id() noexcept
+        {
+            static std::atomic<std::size_t> counter{0u};
+            return ++counter;
+        }
+    } // namespace detail
+
     template<typename Arch, typename Dimension, typename Layout>
     struct serialization
     {
@@ -134,6 +146,28 @@ namespace structured {
                 buffer += is.size();
             }
         }
+
+        template<typename T, typename IndexContainer, typename Strides, typename Array, typename Op>
+        GT_FUNCTION_HOST
+        static void accumulate(const T* buffer, const IndexContainer& c, T* m_data, const Strides& m_byte_strides, 
+                               const Array& m_offsets, Op op)
+        {
+            for (const auto& is : c)
+            {
+                ::gridtools::ghex::detail::for_loop_pointer_arithmetic<Dimension::value,Dimension::value,Layout>::apply(
+                    [m_data,buffer,&op](auto o_data, auto o_buffer)
+                    {
+                        T& x = *reinterpret_cast<T*>(reinterpret_cast<char*>(m_data)+o_data);
+                        x = op(x, *reinterpret_cast<const T*>(reinterpret_cast<const char*>(buffer)+o_buffer)); 
+                    }, 
+                    is.local().first(), 
+                    is.local().last(),
+                    m_byte_strides,
+                    m_offsets
+                    );
+                buffer += is.size();
+            }
+        }
     };
 
 
@@ -215,6 +249,7 @@ namespace structured {
         coordinate_type m_extents;
         device_id_type  m_device_id;
         strides_type    m_byte_strides;
+        std::size_t     m_id = 0u;
 
     public: // ctors
         
@@ -229,7 +264,7 @@ namespace structured {
         template<typename Array>
         GT_FUNCTION_HOST
         simple_field_wrapper(domain_id_type dom_id, value_type* data, const Array& offsets, const Array& extents, device_id_type d_id = 0)
-        : m_dom_id(dom_id), m_data(data), m_device_id(d_id)
+        : m_dom_id(dom_id), m_data(data), m_device_id(d_id), m_id(detail::next_field_id())
         { 
             std::copy(offsets.begin(), offsets.end(), m_offsets.begin());
             std::copy(extents.begin(), extents.end(), m_extents.begin());
@@ -240,7 +275,7 @@ namespace structured {
         template<typename Array0, typename Array1, typename Array2>
         GT_FUNCTION_HOST
         simple_field_wrapper(domain_id_type dom_id, value_type* data, const Array0& offsets, const Array1& extents, const Array2& byte_strides, device_id_type d_id = 0)
-        : m_dom_id(dom_id), m_data(data), m_device_id(d_id)
+        : m_dom_id(dom_id), m_data(data), m_device_id(d_id), m_id(detail::next_field_id())
         { 
             std::copy(offsets.begin(), offsets.end(), m_offsets.begin());
             std::copy(extents.begin(), extents.end(), m_extents.begin());
@@ -250,7 +285,7 @@ namespace structured {
         template<typename Array>
         GT_FUNCTION_HOST
         simple_field_wrapper(domain_id_type dom_id, value_type* data, const Array& offsets, const Array& extents, padding_256, device_id_type d_id = 0)
-        : m_dom_id(dom_id), m_data(data), m_device_id(d_id)
+        : m_dom_id(dom_id), m_data(data), m_device_id(d_id), m_id(detail::next_field_id())
         { 
             std::copy(offsets.begin(), offsets.end(), m_offsets.begin());
             std::copy(extents.begin(), extents.end(), m_extents.begin());
@@ -294,6 +329,12 @@ namespace structured {
         GT_FUNCTION
         value_type* data() const { return m_data; }
 
+        /** @brief id which identifies this field, e.g. for versioned exchanges (see buffer_info::version): 
+         * each wrapper constructed from a pointer gets a new id, copies share the id of the original.
+         * @return id of this field (0 for default constructed wrappers) */
+        GT_FUNCTION
+        std::size_t id() const noexcept { return m_id; }
+
         GT_FUNCTION
         void set_data(value_type* ptr) { m_data = ptr; }
 
@@ -326,6 +367,170 @@ namespace structured {
         {
             serialization<Arch,dimension,layout_map>::unpack(buffer, c, m_data, m_byte_strides, m_offsets, arg);
         }
+
+        /** @brief combine received values with the values of a region of this field (cpu only), used by reverse
+         * exchanges: each value x is replaced by op(x, y), where y is the corresponding value in the buffer
+         * @tparam IndexContainer iteration space container type
+         * @tparam Op binary operation
+         * @param buffer serialized values
+         * @param c iteration spaces
+         * @param op operation */
+        template<typename IndexContainer, typename Op, typename A = Arch>
+        std::enable_if_t<std::is_same<A,cpu>::value>
+        accumulate(const T* buffer, const IndexContainer& c, Op op, void*)
+        {
+            serialization<Arch,dimension,layout_map>::accumulate(buffer, c, m_data, m_byte_strides, m_offsets, op);
+        }
+
+        /** @brief copy a halo region from this field directly into the halo region of another field on the same
+         * rank (cpu only). The iteration spaces of both containers are matched pairwise and must have equal
+         * extents, i.e. the copy is equivalent to packing with src_c and unpacking with dst_c.
+         * @tparam IndexContainer iteration space container type
+         * @param dst destination field
+         * @param src_c iteration spaces in this field
+         * @param dst_c iteration spaces in the destination field */
+        template<typename IndexContainer, typename A = Arch>
+        std::enable_if_t<std::is_same<A,cpu>::value>
+        local_copy(simple_field_wrapper& dst, const IndexContainer& src_c, const IndexContainer& dst_c) const
+        {
+            auto dst_it = dst_c.begin();
+            for (const auto& is : src_c)
+            {
+                coordinate_type first, last, dst_shift;
+                for (int d=0; d<dimension::value; ++d)
+                {
+                    first[d]     = is.local().first()[d];
+                    last[d]      = is.local().last()[d];
+                    dst_shift[d] = dst_it->local().first()[d] - first[d] + dst.m_offsets[d];
+                }
+                ::gridtools::ghex::detail::for_loop<dimension::value,dimension::value,layout_map>::apply(
+                    [this,&dst,&dst_shift](auto... xs)
+                    {
+                        const coordinate_type x{xs...};
+                        *reinterpret_cast<T*>((char*)dst.m_data + dot(x+dst_shift, dst.m_byte_strides)) =
+                        *reinterpret_cast<const T*>((const char*)m_data + dot(x+m_offsets, m_byte_strides));
+                    },
+                    first,
+                    last);
+                ++dst_it;
+            }
+        }
+
+        /** @brief check whether a set of iteration spaces is a single region which is contiguous in memory, such
+         * that its serialized form is identical to the memory it occupies in the field
+         * @tparam IndexContainer iteration space container type
+         * @param c iteration spaces
+         * @return pointer to the first element of the region, or nullptr if it is not contiguous */
+        template<typename IndexContainer>
+        value_type* contiguous_data(const IndexContainer& c) const
+        {
+            if (c.size() != 1u) return nullptr;
+            const auto& first = c.begin()->local().first();
+            const auto& last  = c.begin()->local().last();
+            const int order[dimension::value] = {Order...};
+            // walk the dimensions from stride-1 to outermost: every dimension with more than one point must have
+            // the stride of the (dense) sub-region spanned by the faster dimensions
+            std::size_t expected_stride = sizeof(value_type);
+            for (int l=dimension::value-1; l>=0; --l)
+            {
+                int d = 0;
+                while (order[d] != l) ++d;
+                const std::size_t n = last[d]-first[d]+1;
+                if (l == dimension::value-1 && m_byte_strides[d] != sizeof(value_type)) return nullptr;
+                if (n == 1u) continue;
+                if (m_byte_strides[d] != expected_stride) return nullptr;
+                expected_stride = m_byte_strides[d]*n;
+            }
+            coordinate_type x;
+            for (int d=0; d<dimension::value; ++d) x[d] = first[d];
+            return reinterpret_cast<value_type*>((char*)m_data + dot(x+m_offsets, m_byte_strides));
+        }
+
+        /** @brief split a set of iteration spaces into consecutive parts of at most max_elements points (but at
+         * least one point), such that packing the parts one after the other yields the same serialized values
+         * as packing the whole set. Iteration spaces are cut into slabs along the outermost dimension of the
+         * layout, and further along inner dimensions if a single layer is too large. Since the cuts only depend
+         * on the shape of the iteration spaces and the layout, fields with the same layout split corresponding
+         * sets of iteration spaces (e.g. send and receive halos) alike.
+         * @tparam IndexContainer iteration space container type
+         * @param c iteration spaces
+         * @param max_elements maximum number of points per part
+         * @return parts of the iteration spaces */
+        template<typename IndexContainer>
+        std::vector<IndexContainer> split(const IndexContainer& c, std::size_t max_elements) const
+        {
+            max_elements = std::max(max_elements, std::size_t{1});
+            std::vector<IndexContainer> parts(1);
+            std::size_t n = 0u;
+            for (const auto& is : c)
+                split(is, 0, max_elements, parts, n);
+            if (parts.back().empty()) parts.pop_back();
+            return parts;
+        }
+
+    private: // implementation
+
+        // append an iteration space to the last part, or cut it along the dimension with layout index l (and the
+        // inner ones) into pieces which start new parts; n counts the points of the last part
+        template<typename IterationSpace, typename IndexContainer>
+        static void split(const IterationSpace& is, int l, std::size_t max_elements, std::vector<IndexContainer>& parts,
+            std::size_t& n)
+        {
+            const std::size_t size = is.size();
+            if (n + size <= max_elements)
+            {
+                parts.back().push_back(is);
+                n += size;
+                return;
+            }
+            if (n > 0u)
+            {
+                parts.emplace_back();
+                n = 0u;
+            }
+            if (size <= max_elements)
+            {
+                parts.back().push_back(is);
+                n = size;
+                return;
+            }
+            const int order[dimension::value] = {Order...};
+            int d = 0;
+            while (order[d] != l) ++d;
+            const auto first = is.local().first()[d];
+            const auto last  = is.local().last()[d];
+            const std::size_t layer = size/(last-first+1);
+            // points of the slabs: whole layers, or single layers which are split further
+            const auto step = layer > max_elements ? 1 : static_cast<decltype(last-first)>(max_elements/layer);
+            for (auto x = first; x <= last; x += step)
+            {
+                auto slab = is;
+                const auto lo = x-first;
+                const auto hi = last-std::min(x+step-1, last);
+                slab.local().first()[d]  += lo;
+                slab.local().last()[d]   -= hi;
+                slab.global().first()[d] += lo;
+                slab.global().last()[d]  -= hi;
+                // halo layer numbers advance with the coordinate, unless the region lies within a single layer
+                if (is.layers().last()[d]-is.layers().first()[d] == last-first)
+                {
+                    slab.layers().first()[d] += lo;
+                    slab.layers().last()[d]  -= hi;
+                }
+                if (layer > max_elements)
+                    split(slab, l+1, max_elements, parts, n);
+                else
+                {
+                    if (n > 0u)
+                    {
+                        parts.emplace_back();
+                        n = 0u;
+                    }
+                    parts.back().push_back(slab);
+                    n = slab.size();
+                }
+            }
+        }
     };
 } // namespace structured
 
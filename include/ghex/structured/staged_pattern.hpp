@@ -0,0 +1,96 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2019, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef INCLUDED_GHEX_STRUCTURED_STAGED_PATTERN_HPP
+#define INCLUDED_GHEX_STRUCTURED_STAGED_PATTERN_HPP
+
+#include "./domain_descriptor.hpp"
+#include "./pattern.hpp"
+#include <vector>
+#include <utility>
+
+namespace gridtools {
+    namespace ghex {
+        namespace structured {
+
+            /** @brief holds one pattern container per stage of a staged exchange, which are exchanged one after 
+              * another (see communication_object::bexchange_staged)
+              * @tparam PatternContainer pattern container type */
+            template<typename PatternContainer>
+            class staged_pattern_container
+            {
+            public: // member types
+                using pattern_container_type = PatternContainer;
+
+            private: // members
+                std::vector<PatternContainer> m_stages;
+
+            public: // ctors
+                staged_pattern_container(std::vector<PatternContainer>&& stages) noexcept
+                : m_stages(std::move(stages))
+                {}
+                staged_pattern_container(const staged_pattern_container&) = delete;
+                staged_pattern_container(staged_pattern_container&&) noexcept = default;
+
+            public: // member functions
+                /** @return number of stages */
+                int size() const noexcept { return m_stages.size(); }
+                /** @return pattern container of stage i */
+                const PatternContainer& operator[](int i) const noexcept { return m_stages[i]; }
+
+                /** @brief bind a field to the patterns of all stages
+                  * @tparam Field field type
+                  * @param field field instance
+                  * @return one buffer_info per stage */
+                template<typename Field>
+                auto operator()(Field& field) const
+                {
+                    std::vector<decltype(m_stages[0](field))> result;
+                    result.reserve(m_stages.size());
+                    for (const auto& s : m_stages)
+                        result.push_back(s(field));
+                    return result;
+                }
+            };
+
+            /** @brief construct patterns for exchanging the halos dimension by dimension: stage d exchanges the
+              * faces of dimension d only, extended by the halos of dimensions 0,...,d-1 which were received in the 
+              * earlier stages. Edges and corners are thus forwarded by the face neighbors, and each domain sends
+              * at most 2 messages per dimension instead of up to 3^D-1. Requires that face neighbors cover the
+              * same range in all other dimensions (e.g. Cartesian decompositions). Collective.
+              * @tparam DomainIdType domain id type
+              * @tparam Dimension number of dimensions
+              * @tparam DomainRange range type holding domains
+              * @param comm MPI communicator
+              * @param hgen halo generator describing the full halos
+              * @param d_range range of local domains
+              * @return staged pattern container */
+            template<typename DomainIdType, int Dimension, typename DomainRange>
+            auto make_staged_pattern(MPI_Comm comm, const halo_generator<DomainIdType,Dimension>& hgen, DomainRange&& d_range)
+            {
+                using domain_type    = domain_descriptor<DomainIdType,Dimension>;
+                using container_type = decltype(::gridtools::ghex::make_pattern<grid>(comm, hgen, d_range));
+                using impl_type      = ::gridtools::ghex::detail::make_pattern_impl<typename grid::template type<domain_type>>;
+                std::vector<container_type> stages;
+                stages.reserve(Dimension);
+                for (int d=0; d<Dimension; ++d)
+                {
+                    stages.push_back(::gridtools::ghex::make_pattern<grid>(comm, hgen.faces(d), d_range));
+                    impl_type::extend_stage(stages.back(), comm, d, hgen.halos(), hgen.periodic());
+                }
+                return staged_pattern_container<container_type>(std::move(stages));
+            }
+
+        } // namespace structured
+    } // namespace ghex
+} // namespace gridtools
+
+#endif /* INCLUDED_GHEX_STRUCTURED_STAGED_PATTERN_HPP */
+
@@ -16,6 +16,7 @@
 #include "./communicator_base.hpp"
 #include "./future.hpp"
 #include "./communicator_traits.hpp"
+#include "./datatype.hpp"
 
 namespace gridtools {
     
@@ -37,6 +38,8 @@ namespace gridtools {
                 using size_type      = typename base_type::size_type;
                 using tag_type       = typename base_type::tag_type;
                 using request        = mpi::request;
+                using persistent_request = mpi::persistent_request;
+                using datatype       = mpi::datatype;
                 using status         = mpi::status;
                 template<typename T>
                 using future         = mpi::future<T>;
@@ -75,7 +78,117 @@ namespace gridtools {
                     );
                     return req;
                 }
+
+                /** @brief non-blocking send of memory described by a derived datatype
+                  * @param type datatype holding absolute addresses
+                  * @param dest destination rank
+                  * @param tag message tag
+                  * @return completion handle */
+                [[nodiscard]] future<void> send(const datatype& type, rank_type dest, tag_type tag) const
+                {
+                    request req;
+                    GHEX_CHECK_MPI_RESULT(MPI_Isend(MPI_BOTTOM, 1, type, dest, tag, *this, &req.get()));
+                    return req;
+                }
             
+            public: // persistent send and recv
+
+                /** @brief create a persistent send request. The message must not be reallocated during the lifetime
+                  * of the request.
+                  * @tparam Message a container type
+                  * @param msg source container
+                  * @param dest destination rank
+                  * @param tag message tag
+                  * @return inactive persistent request */
+                template<typename Message>
+                [[nodiscard]] persistent_request send_init(const Message& msg, rank_type dest, tag_type tag) const
+                {
+                    persistent_request req;
+                    GHEX_CHECK_MPI_RESULT(
+                        MPI_Send_init(reinterpret_cast<const void*>(msg.data()),sizeof(typename Message::value_type)*msg.size(), 
+                                      MPI_BYTE, dest, tag, *this, &req.get())
+                    );
+                    return req;
+                }
+
+                /** @brief create a persistent receive request. The message must not be reallocated during the
+                  * lifetime of the request.
+                  * @tparam Message a container type
+                  * @param msg destination container
+                  * @param source source rank
+                  * @param tag message tag
+                  * @return inactive persistent request */
+                template<typename Message>
+                [[nodiscard]] persistent_request recv_init(Message& msg, rank_type source, tag_type tag) const
+                {
+                    persistent_request req;
+                    GHEX_CHECK_MPI_RESULT(
+                        MPI_Recv_init(reinterpret_cast<void*>(msg.data()),sizeof(typename Message::value_type)*msg.size(), 
+                                      MPI_BYTE, source, tag, *this, &req.get())
+                    );
+                    return req;
+                }
+
+                /** @brief create a persistent send request for memory described by a derived datatype
+                  * @param type datatype holding absolute addresses
+                  * @param dest destination rank
+                  * @param tag message tag
+                  * @return inactive persistent request */
+                [[nodiscard]] persistent_request send_init(const datatype& type, rank_type dest, tag_type tag) const
+                {
+                    persistent_request req;
+                    GHEX_CHECK_MPI_RESULT(MPI_Send_init(MPI_BOTTOM, 1, type, dest, tag, *this, &req.get()));
+                    return req;
+                }
+
+                /** @brief create a persistent receive request for memory described by a derived datatype
+                  * @param type datatype holding absolute addresses
+                  * @param source source rank
+                  * @param tag message tag
+                  * @return inactive persistent request */
+                [[nodiscard]] persistent_request recv_init(const datatype& type, rank_type source, tag_type tag) const
+                {
+                    persistent_request req;
+                    GHEX_CHECK_MPI_RESULT(MPI_Recv_init(MPI_BOTTOM, 1, type, source, tag, *this, &req.get()));
+                    return req;
+                }
+
+                /** @brief start a persistent request
+                  * @param req inactive persistent request
+                  * @return completion handle */
+                [[nodiscard]] future<void> start(persistent_request& req) const
+                {
+                    return req.start();
+                }
+
+                /** @brief start a contiguous range of persistent requests at once
+                  * @param first pointer to first request
+                  * @param n number of requests */
+                void start_all(persistent_request* first, std::size_t n) const
+                {
+                    if (n == 0u) return;
+                    GHEX_CHECK_MPI_RESULT(MPI_Startall(static_cast<int>(n), &first->get()));
+                }
+
+            public: // collectives
+
+                /** @brief non-blocking reduction over all ranks
+                  * @tparam T arithmetic type
+                  * @param send_buf values contributed by this rank (may equal recv_buf for an in-place reduction)
+                  * @param recv_buf reduced values
+                  * @param count number of values
+                  * @param op reduction operation
+                  * @return completion handle */
+                template<typename T>
+                [[nodiscard]] future<void> allreduce(const T* send_buf, T* recv_buf, int count, MPI_Op op) const
+                {
+                    request req;
+                    const void* send = (send_buf == recv_buf) ? MPI_IN_PLACE : static_cast<const void*>(send_buf);
+                    GHEX_CHECK_MPI_RESULT(MPI_Iallreduce(send, recv_buf, count, mpi::builtin_datatype<T>::get(), op, 
+                        *this, &req.get()));
+                    return req;
+                }
+
             public: // recv
 
                 /** @brief non-blocking receive
@@ -94,6 +207,18 @@ namespace gridtools {
                     return req;
                 }
 
+                /** @brief non-blocking receive into memory described by a derived datatype
+                  * @param type datatype holding absolute addresses
+                  * @param source source rank
+                  * @param tag message tag
+                  * @return completion handle */
+                [[nodiscard]] future<void> recv(const datatype& type, rank_type source, tag_type tag) const
+                {
+                    request req;
+                    GHEX_CHECK_MPI_RESULT(MPI_Irecv(MPI_BOTTOM, 1, type, source, tag, *this, &req.get()));
+                    return req;
+                }
+
                 /** @brief non-blocking receive which allocates the container within this function and returns it
                   * in the future 
                   * @tparam Message a container type
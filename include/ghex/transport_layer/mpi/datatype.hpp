@@ -0,0 +1,111 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2019, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef INCLUDED_GHEX_TL_MPI_DATATYPE_HPP
+#define INCLUDED_GHEX_TL_MPI_DATATYPE_HPP
+
+#include "./error.hpp"
+#include <utility>
+#include <cstddef>
+
+namespace gridtools{
+    namespace ghex {
+        namespace tl {
+            namespace mpi {
+
+                /** @brief owning wrapper around a committed MPI derived datatype. The datatype describes memory
+                  * through absolute addresses (obtained with MPI_Get_address), such that a message consists of
+                  * exactly one element of this type located at MPI_BOTTOM. The type is freed on destruction. */
+                class datatype
+                {
+                private: // members
+
+                    MPI_Datatype m_type = MPI_DATATYPE_NULL;
+
+                public: // ctors
+
+                    datatype() noexcept = default;
+
+                    /** @brief take ownership of an uncommitted datatype and commit it
+                      * @param type datatype handle */
+                    explicit datatype(MPI_Datatype type)
+                    : m_type{type}
+                    {
+                        GHEX_CHECK_MPI_RESULT(MPI_Type_commit(&m_type));
+                    }
+
+                    datatype(const datatype&) = delete;
+                    datatype(datatype&& other) noexcept
+                    : m_type{other.m_type}
+                    {
+                        other.m_type = MPI_DATATYPE_NULL;
+                    }
+                    datatype& operator=(const datatype&) = delete;
+                    datatype& operator=(datatype&& other) noexcept
+                    {
+                        std::swap(m_type, other.m_type);
+                        return *this;
+                    }
+                    ~datatype()
+                    {
+                        if (m_type != MPI_DATATYPE_NULL)
+                            MPI_Type_free(&m_type);
+                    }
+
+                public: // member functions
+
+                    /** @return number of bytes transmitted by one element of this type */
+                    std::size_t size() const
+                    {
+                        int s = 0;
+                        GHEX_CHECK_MPI_RESULT(MPI_Type_size(m_type, &s));
+                        return static_cast<std::size_t>(s);
+                    }
+
+                    operator MPI_Datatype() const noexcept { return m_type; }
+                    MPI_Datatype get() const noexcept { return m_type; }
+                };
+
+                /** @brief predefined MPI datatype of an arithmetic type
+                  * @tparam T arithmetic type */
+                template<typename T>
+                struct builtin_datatype;
+
+#define GHEX_MPI_BUILTIN_DATATYPE(T, MPI_T)                                         \
+                template<>                                                          \
+                struct builtin_datatype<T>                                          \
+                {                                                                   \
+                    static MPI_Datatype get() noexcept { return MPI_T; }            \
+                };
+
+                GHEX_MPI_BUILTIN_DATATYPE(char, MPI_CHAR)
+                GHEX_MPI_BUILTIN_DATATYPE(signed char, MPI_SIGNED_CHAR)
+                GHEX_MPI_BUILTIN_DATATYPE(unsigned char, MPI_UNSIGNED_CHAR)
+                GHEX_MPI_BUILTIN_DATATYPE(short, MPI_SHORT)
+                GHEX_MPI_BUILTIN_DATATYPE(unsigned short, MPI_UNSIGNED_SHORT)
+                GHEX_MPI_BUILTIN_DATATYPE(int, MPI_INT)
+                GHEX_MPI_BUILTIN_DATATYPE(unsigned int, MPI_UNSIGNED)
+                GHEX_MPI_BUILTIN_DATATYPE(long, MPI_LONG)
+                GHEX_MPI_BUILTIN_DATATYPE(unsigned long, MPI_UNSIGNED_LONG)
+                GHEX_MPI_BUILTIN_DATATYPE(long long, MPI_LONG_LONG)
+                GHEX_MPI_BUILTIN_DATATYPE(unsigned long long, MPI_UNSIGNED_LONG_LONG)
+                GHEX_MPI_BUILTIN_DATATYPE(float, MPI_FLOAT)
+                GHEX_MPI_BUILTIN_DATATYPE(double, MPI_DOUBLE)
+                GHEX_MPI_BUILTIN_DATATYPE(long double, MPI_LONG_DOUBLE)
+
+#undef GHEX_MPI_BUILTIN_DATATYPE
+
+            } // namespace mpi
+        } // namespace tl
+    } // namespace ghex
+} // namespace gridtools
+
+#endif /* INCLUDED_GHEX_TL_MPI_DATATYPE_HPP */
+
@@ -58,6 +58,9 @@ namespace gridtools{
                         return std::move(m_data); 
                     }
 
+                    /** @return the value without waiting for completion (e.g. meta data attached to a receive) */
+                    const value_type& peek() const noexcept { return m_data; }
+
                     /** Cancel the future.
                       * @return True if the request was successfully canceled */
                     bool cancel()
@@ -0,0 +1,165 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2019, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef INCLUDED_GHEX_TL_MPI_NODE_TOPOLOGY_HPP
+#define INCLUDED_GHEX_TL_MPI_NODE_TOPOLOGY_HPP
+
+#include "./communicator_base.hpp"
+#include <vector>
+#include <utility>
+
+namespace gridtools{
+    namespace ghex {
+        namespace tl {
+            namespace mpi {
+
+                /** @brief describes which ranks of a communicator share a node. Each node is represented by a
+                  * leader, the rank with the lowest node-local rank. Construction is collective. */
+                class node_topology
+                {
+                private: // members
+
+                    communicator_base m_node_comm;
+                    std::vector<int> m_leaders;
+
+                public: // ctors
+
+                    /** @brief derive the nodes from shared memory domains (MPI_Comm_split_type)
+                      * @param comm communicator */
+                    node_topology(MPI_Comm comm)
+                    : m_node_comm{split(comm), comm_take_ownership}
+                    {
+                        init(comm);
+                    }
+
+                    /** @brief use a user defined grouping into nodes. The ranks of each group must be able to
+                      * share memory.
+                      * @param comm communicator
+                      * @param node_comm communicator of the ranks on this rank's node (duplicated) */
+                    node_topology(MPI_Comm comm, MPI_Comm node_comm)
+                    : m_node_comm{dup(node_comm), comm_take_ownership}
+                    {
+                        init(comm);
+                    }
+
+                    node_topology(const node_topology&) = delete;
+                    node_topology& operator=(const node_topology&) = delete;
+
+                public: // member functions
+
+                    /** @return communicator of the ranks on this rank's node */
+                    const communicator_base& node_comm() const noexcept { return m_node_comm; }
+
+                    /** @param rank rank in the communicator
+                      * @return rank of the leader of the given rank's node */
+                    int leader(int rank) const noexcept { return m_leaders[rank]; }
+
+                    /** @return whether this rank is the leader of its node */
+                    bool is_leader() const noexcept { return m_node_comm.rank() == 0; }
+
+                private: // implementation
+
+                    static MPI_Comm split(MPI_Comm comm)
+                    {
+                        int rank;
+                        GHEX_CHECK_MPI_RESULT(MPI_Comm_rank(comm, &rank));
+                        MPI_Comm node_comm;
+                        GHEX_CHECK_MPI_RESULT(MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &node_comm));
+                        return node_comm;
+                    }
+
+                    static MPI_Comm dup(MPI_Comm comm)
+                    {
+                        MPI_Comm new_comm;
+                        GHEX_CHECK_MPI_RESULT(MPI_Comm_dup(comm, &new_comm));
+                        return new_comm;
+                    }
+
+                    void init(MPI_Comm comm)
+                    {
+                        int rank, size;
+                        GHEX_CHECK_MPI_RESULT(MPI_Comm_rank(comm, &rank));
+                        GHEX_CHECK_MPI_RESULT(MPI_Comm_size(comm, &size));
+                        int leader = rank;
+                        GHEX_CHECK_MPI_RESULT(MPI_Bcast(&leader, 1, MPI_INT, 0, m_node_comm));
+                        m_leaders.resize(size);
+                        GHEX_CHECK_MPI_RESULT(MPI_Allgather(&leader, 1, MPI_INT, m_leaders.data(), 1, MPI_INT, comm));
+                    }
+                };
+
+                /** @brief owning wrapper around a shared memory window of a node, allocated by the node leader.
+                  * All ranks of the node obtain a pointer to the same memory. The window is kept in a passive
+                  * target epoch such that accesses can be ordered with sync and a barrier on the node.
+                  * Construction is collective over the node communicator. */
+                class shared_window
+                {
+                private: // members
+
+                    MPI_Win m_win = MPI_WIN_NULL;
+                    unsigned char* m_data = nullptr;
+
+                public: // ctors
+
+                    /** @brief allocate the window
+                      * @param node_comm node communicator
+                      * @param size size in bytes (only used by the leader, node rank 0) */
+                    shared_window(const communicator_base& node_comm, std::size_t size)
+                    {
+                        void* ptr;
+                        GHEX_CHECK_MPI_RESULT(MPI_Win_allocate_shared(node_comm.rank() == 0 ? static_cast<MPI_Aint>(size) : 0,
+                            1, MPI_INFO_NULL, node_comm, &ptr, &m_win));
+                        MPI_Aint s;
+                        int disp_unit;
+                        GHEX_CHECK_MPI_RESULT(MPI_Win_shared_query(m_win, 0, &s, &disp_unit, &ptr));
+                        m_data = reinterpret_cast<unsigned char*>(ptr);
+                        GHEX_CHECK_MPI_RESULT(MPI_Win_lock_all(MPI_MODE_NOCHECK, m_win));
+                    }
+
+                    shared_window(const shared_window&) = delete;
+                    shared_window(shared_window&& other) noexcept
+                    : m_win{other.m_win}, m_data{other.m_data}
+                    {
+                        other.m_win = MPI_WIN_NULL;
+                    }
+                    shared_window& operator=(const shared_window&) = delete;
+                    shared_window& operator=(shared_window&& other) noexcept
+                    {
+                        std::swap(m_win, other.m_win);
+                        std::swap(m_data, other.m_data);
+                        return *this;
+                    }
+                    ~shared_window()
+                    {
+                        if (m_win != MPI_WIN_NULL)
+                        {
+                            MPI_Win_unlock_all(m_win);
+                            MPI_Win_free(&m_win);
+                        }
+                    }
+
+                public: // member functions
+
+                    /** @return pointer to the shared memory */
+                    unsigned char* data() const noexcept { return m_data; }
+
+                    /** @brief synchronize the private and public copies of the window memory */
+                    void sync() const
+                    {
+                        GHEX_CHECK_MPI_RESULT(MPI_Win_sync(m_win));
+                    }
+                };
+
+            } // namespace mpi
+        } // namespace tl
+    } // namespace ghex
+} // namespace gridtools
+
+#endif /* INCLUDED_GHEX_TL_MPI_NODE_TOPOLOGY_HPP */
+
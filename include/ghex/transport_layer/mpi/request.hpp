@@ -13,6 +13,7 @@
 
 #include "./error.hpp"
 #include "../../common/c_managed_struct.hpp"
+#include <utility>
 
 namespace gridtools{
     namespace ghex {
@@ -45,6 +46,58 @@ namespace gridtools{
                     const MPI_Request& get() const noexcept { return m_req; }
                 };
 
+                /** @brief owning wrapper around a persistent MPI_Request (created through MPI_Send_init or
+                  * MPI_Recv_init). The request can be started repeatedly and is freed on destruction. Contains only
+                  * the MPI_Request handle, such that a contiguous range can be passed to MPI_Startall. */
+                struct persistent_request
+                {
+                    MPI_Request m_req = MPI_REQUEST_NULL;
+
+                    persistent_request() noexcept = default;
+                    persistent_request(const persistent_request&) = delete;
+                    persistent_request(persistent_request&& other) noexcept
+                    : m_req{other.m_req}
+                    {
+                        other.m_req = MPI_REQUEST_NULL;
+                    }
+                    persistent_request& operator=(const persistent_request&) = delete;
+                    persistent_request& operator=(persistent_request&& other) noexcept
+                    {
+                        std::swap(m_req, other.m_req);
+                        return *this;
+                    }
+                    ~persistent_request()
+                    {
+                        if (m_req != MPI_REQUEST_NULL)
+                            MPI_Request_free(&m_req);
+                    }
+
+                    /** @brief start the communication
+                      * @return non-owning request handle which can be used to wait for completion */
+                    request start()
+                    {
+                        GHEX_CHECK_MPI_RESULT(MPI_Start(&m_req));
+                        return get_request();
+                    }
+
+                    /** @return non-owning request handle. Completing it leaves this request inactive and ready
+                      * for the next start */
+                    request get_request() const noexcept
+                    {
+                        request req;
+                        req.m_req = request::req_type{m_req};
+                        return req;
+                    }
+
+                    operator       MPI_Request&()       noexcept { return m_req; }
+                    operator const MPI_Request&() const noexcept { return m_req; }
+                          MPI_Request& get()       noexcept { return m_req; }
+                    const MPI_Request& get() const noexcept { return m_req; }
+                };
+
+                static_assert(sizeof(persistent_request) == sizeof(MPI_Request), 
+                    "persistent_request must have the same layout as MPI_Request");
+
             } // namespace mpi
         } // namespace tl
     } // namespace ghex
@@ -0,0 +1,145 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2019, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef INCLUDED_GHEX_TL_MPI_TAG_SLOT_HPP
+#define INCLUDED_GHEX_TL_MPI_TAG_SLOT_HPP
+
+#include "./error.hpp"
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace gridtools{
+    namespace ghex {
+        namespace tl {
+            namespace mpi {
+
+                /** @return largest tag supported by the MPI implementation (MPI_TAG_UB, at least 32767) */
+                inline int tag_ub()
+                {
+                    static const int ub = []()
+                    {
+                        void* ptr;
+                        int flag;
+                        GHEX_CHECK_MPI_RESULT(MPI_Comm_get_attr(MPI_COMM_WORLD, MPI_TAG_UB, &ptr, &flag));
+                        return flag ? *static_cast<int*>(ptr) : 32767;
+                    }();
+                    return ub;
+                }
+
+                /** @brief a process-wide reserved id, which selects a tag range (see communication_object). Ids
+                  * given explicitly may be shared by several slots, ids assigned automatically are unique among
+                  * the live slots of all ranks of a communicator. The id 0 is not reserved and always available. */
+                class tag_slot
+                {
+                private: // members
+
+                    int m_id = 0;
+
+                public: // ctors
+
+                    /** @brief slot with id 0 */
+                    tag_slot() noexcept = default;
+
+                    /** @brief reserve a given id
+                      * @param id id between 0 and max_id
+                      * @param max_id largest id */
+                    tag_slot(int id, int max_id)
+                    {
+                        if (id < 0 || id > max_id)
+                            throw std::runtime_error("tag slot id must be between 0 and " + std::to_string(max_id));
+                        if (id == 0) return;
+                        std::lock_guard<std::mutex> lock(mutex());
+                        auto& count = ids()[id];
+                        if (count < 0)
+                            throw std::runtime_error("tag slot " + std::to_string(id) + " is assigned automatically");
+                        ++count;
+                        m_id = id;
+                    }
+
+                    tag_slot(const tag_slot&) = delete;
+                    tag_slot(tag_slot&& other) noexcept : m_id{other.m_id} { other.m_id = 0; }
+                    tag_slot& operator=(const tag_slot&) = delete;
+                    tag_slot& operator=(tag_slot&& other) noexcept
+                    {
+                        release();
+                        m_id = other.m_id;
+                        other.m_id = 0;
+                        return *this;
+                    }
+                    ~tag_slot() { release(); }
+
+                public: // member functions
+
+                    /** @brief reserve the lowest id between 1 and max_id which is not in use on any rank of a 
+                      * communicator, such that all ranks obtain the same id irrespective of the slots they hold. 
+                      * Collective over the communicator: slots must be created in the same order on all ranks, and
+                      * not concurrently by several threads of a rank (use explicit ids instead).
+                      * @param max_id largest id
+                      * @param comm communicator
+                      * @return slot with the reserved id */
+                    static tag_slot lowest_free(int max_id, MPI_Comm comm)
+                    {
+                        // flags of the ids 1..max_id which are free on this rank, and on all ranks after reduction
+                        std::vector<int> free(max_id, 1);
+                        {
+                            std::lock_guard<std::mutex> lock(mutex());
+                            for (const auto& p : ids())
+                                if (p.first <= max_id) free[p.first-1] = 0;
+                        }
+                        GHEX_CHECK_MPI_RESULT(MPI_Allreduce(MPI_IN_PLACE, free.data(), max_id, MPI_INT, MPI_MIN, comm));
+                        int id = 1;
+                        while (id <= max_id && !free[id-1]) ++id;
+                        if (id > max_id) throw std::runtime_error("all tag slots are in use");
+                        std::lock_guard<std::mutex> lock(mutex());
+                        if (ids().count(id)) 
+                            throw std::runtime_error("tag slot " + std::to_string(id) + " was reserved concurrently");
+                        ids()[id] = -1;
+                        tag_slot slot;
+                        slot.m_id = id;
+                        return slot;
+                    }
+
+                    /** @return id of this slot */
+                    int id() const noexcept { return m_id; }
+
+                private: // implementation
+
+                    void release() noexcept
+                    {
+                        if (m_id == 0) return;
+                        std::lock_guard<std::mutex> lock(mutex());
+                        auto it = ids().find(m_id);
+                        if (it->second < 0 || --(it->second) == 0) ids().erase(it);
+                        m_id = 0;
+                    }
+
+                    static std::mutex& mutex()
+                    {
+                        static std::mutex m;
+                        return m;
+                    }
+
+                    // number of live slots per id, -1 for ids assigned automatically
+                    static std::map<int,int>& ids()
+                    {
+                        static std::map<int,int> m;
+                        return m;
+                    }
+                };
+
+            } // namespace mpi
+        } // namespace tl
+    } // namespace ghex
+} // namespace gridtools
+
+#endif /* INCLUDED_GHEX_TL_MPI_TAG_SLOT_HPP */
@@ -0,0 +1,178 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2019, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include "./exchange_setup.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <vector>
+
+TEST(exchange_chunks, chunks)
+{
+    exchange_setup s;
+    const std::array<int,6> halos1{1,1,1,1,1,1};
+    const std::array<int,6> halos2{2,2,2,2,2,2};
+    auto pattern1 = s.make_pattern(halos1);
+    auto pattern2 = s.make_pattern(halos2);
+    auto co = gridtools::ghex::make_communication_object<decltype(pattern1)>();
+
+    auto raw_a = s.make_raw_field();
+    auto raw_b = s.make_raw_field();
+    auto raw_c = s.make_raw_field();
+    auto field_a = s.wrap(raw_a);
+    auto field_b = s.wrap(raw_b);
+    auto field_c = s.wrap(raw_c);
+
+    // chunk sizes: single points (fields are split), parts of fields and pairs of fields, no chunking
+    for (std::size_t chunk_size : {std::size_t{1}, std::size_t{200}, std::size_t{0}})
+    {
+        co.set_chunk_size(chunk_size);
+        EXPECT_EQ(co.chunk_size(), chunk_size);
+        for (int k=0; k<2; ++k)
+        {
+            s.fill(field_a, k);
+            s.fill(field_b, k+10);
+            s.fill(field_c, k+20);
+            auto h = co.exchange(pattern1(field_a), pattern2(field_b), pattern1(field_c));
+            while (!h.progress()) {}
+            EXPECT_TRUE(s.check(field_a, halos1, k));
+            EXPECT_TRUE(s.check(field_b, halos2, k+10));
+            EXPECT_TRUE(s.check(field_c, halos1, k+20));
+        }
+    }
+}
+
+TEST(exchange_chunks, split_fields)
+{
+    exchange_setup s;
+    const std::array<int,6> halos{2,2,1,1,1,1};
+    auto pattern = s.make_pattern(halos);
+    auto co = gridtools::ghex::make_communication_object<decltype(pattern)>();
+    gridtools::ghex::thread_pool pool(2);
+
+    auto raw = s.make_raw_field();
+    counting_field<decltype(s.wrap(raw))> field(s.wrap(raw));
+
+    // single field: one message per neighbor rank without chunking, several ones for chunk sizes smaller than
+    // the halos (down to single points), which are split alike on the sending and receiving side
+    int num_messages = 0;
+    for (std::size_t chunk_size : {std::size_t{0}, std::size_t{4*sizeof(int)}, std::size_t{100*sizeof(int)}, 
+        std::size_t{1}})
+    {
+        co.set_chunk_size(chunk_size);
+        for (auto p : {static_cast<gridtools::ghex::thread_pool*>(nullptr), &pool})
+        {
+            co.set_thread_pool(p);
+            s.fill(field, 1);
+            field.num_packed = field.num_unpacked = 0;
+            co.bexchange(pattern(field));
+            EXPECT_TRUE(s.check(field, halos, 1));
+            EXPECT_EQ(field.num_packed, field.num_unpacked);
+            if (chunk_size == 0u)
+                num_messages = field.num_packed;
+            else
+                EXPECT_GT(field.num_packed, num_messages);
+        }
+    }
+    EXPECT_GT(num_messages, 0);
+
+    // the parts of a field cover its halo regions in order
+    const auto& halo_map = pattern[0].send_halos();
+    for (const auto& h : halo_map)
+    {
+        const auto parts = field.split(h.second, 7);
+        EXPECT_GT(parts.size(), 1u);
+        std::vector<int> whole(decltype(pattern)::value_type::num_elements(h.second));
+        std::vector<int> pieces;
+        field.pack(whole.data(), h.second, nullptr);
+        for (const auto& c : parts)
+        {
+            const int n = decltype(pattern)::value_type::num_elements(c);
+            EXPECT_LE(n, 7);
+            EXPECT_GT(n, 0);
+            std::vector<int> piece(n);
+            field.pack(piece.data(), c, nullptr);
+            pieces.insert(pieces.end(), piece.begin(), piece.end());
+        }
+        EXPECT_EQ(pieces, whole);
+    }
+}
+
+TEST(exchange_chunks, wait_field)
+{
+    exchange_setup s;
+    const std::array<int,6> halos1{2,1,1,2,1,0};
+    const std::array<int,6> halos2{1,1,2,2,0,1};
+    auto pattern1 = s.make_pattern(halos1);
+    auto pattern2 = s.make_pattern(halos2);
+    auto co = gridtools::ghex::make_communication_object<decltype(pattern1)>();
+
+    auto raw_a = s.make_raw_field();
+    auto raw_b = s.make_raw_field();
+    auto raw_c = s.make_raw_field();
+    auto field_a = s.wrap(raw_a);
+    auto field_b = s.wrap(raw_b);
+    auto field_c = s.wrap(raw_c);
+
+    auto num_neighbors = [](const auto& pattern)
+    {
+        std::vector<int> ids;
+        for (const auto& p : pattern[0].recv_halos()) ids.push_back(p.first.id);
+        std::sort(ids.begin(), ids.end());
+        return std::unique(ids.begin(), ids.end()) - ids.begin();
+    };
+
+    // one message per field with chunks
+    for (int k=0; k<2; ++k)
+    {
+        co.set_chunk_size(1);
+        s.fill(field_a, k);
+        s.fill(field_b, k+10);
+        s.fill(field_c, k+20);
+        auto h = co.exchange(pattern1(field_a), pattern2(field_b), pattern1(field_c));
+        h.wait_field(field_b);
+        EXPECT_TRUE(s.check(field_b, halos2, k+10));
+        h.wait_field(field_a);
+        EXPECT_TRUE(s.check(field_a, halos1, k));
+        if (k)
+            h.wait();
+        else
+        {
+            // neighbors whose messages were unpacked already are reported as well
+            int reported = 0;
+            h.wait([&reported](int, int) { ++reported; });
+            EXPECT_EQ(reported, num_neighbors(pattern1));
+        }
+        EXPECT_TRUE(s.check(field_c, halos1, k+20));
+    }
+
+    // whole buffers without chunks and in plans: fields do not arrive separately
+    co.set_chunk_size(0);
+    auto plan = co.make_plan(pattern1(field_a), pattern2(field_b), pattern1(field_c));
+    for (int k=0; k<2; ++k)
+    {
+        s.fill(field_a, k);
+        s.fill(field_b, k+10);
+        s.fill(field_c, k+20);
+        auto h = k ? plan.execute() : co.exchange(pattern1(field_a), pattern2(field_b), pattern1(field_c));
+        EXPECT_THROW(h.wait_field(field_b), std::runtime_error);
+        h.wait();
+        EXPECT_TRUE(s.check(field_a, halos1, k));
+        EXPECT_TRUE(s.check(field_b, halos2, k+10));
+        EXPECT_TRUE(s.check(field_c, halos1, k+20));
+    }
+
+    // a field which has buffers of its own
+    s.fill(field_a, 30);
+    auto h = co.exchange(pattern1(field_a));
+    h.wait_field(field_a);
+    EXPECT_TRUE(s.check(field_a, halos1, 30));
+    h.wait();
+}
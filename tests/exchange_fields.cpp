@@ -0,0 +1,147 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2019, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include "./exchange_setup.hpp"
+#include <gtest/gtest.h>
+#include <vector>
+
+TEST(exchange_fields, skip_unchanged)
+{
+    exchange_setup s;
+    const std::array<int,6> halos{2,1,1,2,1,0};
+    auto pattern = s.make_pattern(halos);
+    auto co = gridtools::ghex::make_communication_object<decltype(pattern)>();
+
+    auto raw_a = s.make_raw_field();
+    auto raw_b = s.make_raw_field();
+    counting_field<decltype(s.wrap(raw_a))> field_a(s.wrap(raw_a));
+    auto field_b = s.wrap(raw_b);
+
+    auto halos_untouched = [&](const auto& f)
+    {
+        bool passed = true;
+        for (int z=-s.halo_ext[2]; z<s.local_ext[2]+s.halo_ext[2]; ++z)
+            for (int y=-s.halo_ext[1]; y<s.local_ext[1]+s.halo_ext[1]; ++y)
+                for (int x=-s.halo_ext[0]; x<s.local_ext[0]+s.halo_ext[0]; ++x)
+                {
+                    const bool inner = x>=0 && x<s.local_ext[0] && y>=0 && y<s.local_ext[1] && z>=0 && z<s.local_ext[2];
+                    if (!inner && f(x,y,z) != -1) passed = false;
+                }
+        return passed;
+    };
+
+    // field a is exchanged once per version, field b every time; skipped fields are neither packed nor
+    // received
+    const std::size_t versions[] = {0u, 0u, 1u, 1u, 2u};
+    for (int k=0; k<5; ++k)
+    {
+        s.fill(field_a, k);
+        s.fill(field_b, k+10);
+        field_a.num_packed = field_a.num_unpacked = 0;
+        co.bexchange(pattern(field_a).version(versions[k]), pattern(field_b));
+        const bool changed = (k == 0 || versions[k] != versions[k-1]);
+        if (changed)
+        {
+            EXPECT_TRUE(s.check(field_a, halos, k));
+            EXPECT_GT(field_a.num_packed, 0);
+            EXPECT_GT(field_a.num_unpacked, 0);
+        }
+        else
+        {
+            EXPECT_TRUE(halos_untouched(field_a));
+            EXPECT_EQ(field_a.num_packed, 0);
+            EXPECT_EQ(field_a.num_unpacked, 0);
+        }
+        EXPECT_TRUE(s.check(field_b, halos, k+10));
+    }
+
+    // all fields unchanged: no messages are sent, hence a rank whose neighbors skip as well does not wait for
+    // a message
+    s.fill(field_a, 5);
+    field_a.num_packed = field_a.num_unpacked = 0;
+    auto h = co.exchange(pattern(field_a).version(2u));
+    EXPECT_TRUE(h.test());
+    EXPECT_TRUE(halos_untouched(field_a));
+    EXPECT_EQ(field_a.num_packed, 0);
+
+    // other halo depths are exchanged separately
+    const std::array<int,6> depth{1,1,1,1,1,0};
+    co.bexchange(pattern(field_a).version(2u).halo_depth(std::vector<int>(depth.begin(), depth.end())));
+    EXPECT_TRUE(s.check(field_a, depth, 5));
+
+    // versions are only recorded once an exchange has completed
+    s.fill(field_a, 6);
+    EXPECT_THROW((void)co.exchange(pattern(field_a).version(3u), pattern(field_b).halo_depth({1})), std::runtime_error);
+    co.bexchange(pattern(field_a).version(3u));
+    EXPECT_TRUE(s.check(field_a, halos, 6));
+    s.fill(field_a, 7);
+    co.bexchange(pattern(field_a).version(3u));
+    EXPECT_TRUE(halos_untouched(field_a));
+    s.fill(field_a, 5);
+
+    // plans ignore the version
+    auto plan = co.make_plan(pattern(field_a).version(2u));
+    plan.bexecute();
+    EXPECT_TRUE(s.check(field_a, halos, 5));
+
+    // fields are identified by their id: a new wrapper of the same memory is exchanged
+    auto field_c = s.wrap(raw_a);
+    s.fill(field_c, 8);
+    co.bexchange(pattern(field_c).version(3u));
+    EXPECT_TRUE(s.check(field_c, halos, 8));
+
+    // exchanging a field without a version discards its versions
+    co.bexchange(pattern(field_c));
+    s.fill(field_c, 9);
+    co.bexchange(pattern(field_c).version(3u));
+    EXPECT_TRUE(s.check(field_c, halos, 9));
+
+    // all versions are discarded on reset
+    co.reset_versions();
+    s.fill(field_c, 10);
+    co.bexchange(pattern(field_c).version(3u));
+    EXPECT_TRUE(s.check(field_c, halos, 10));
+
+    // diverging versions are detected on all ranks, and the object remains usable
+    EXPECT_THROW((void)co.exchange(pattern(field_c).version(s.comm.rank() == 0 ? 4u : 3u)), std::runtime_error);
+    s.fill(field_c, 11);
+    co.bexchange(pattern(field_c).version(4u));
+    EXPECT_TRUE(s.check(field_c, halos, 11));
+}
+
+TEST(exchange_fields, ensemble)
+{
+    exchange_setup s;
+    const std::array<int,6> halos{2,1,1,2,1,0};
+    auto pattern = s.make_pattern(halos);
+    auto co = gridtools::ghex::make_communication_object<decltype(pattern)>();
+
+    const int num_members = 5;
+    std::vector<std::vector<int>> raw;
+    for (int m=0; m<num_members; ++m) raw.push_back(s.make_raw_field());
+    std::vector<decltype(s.wrap(raw[0]))> members;
+    for (int m=0; m<num_members; ++m) members.push_back(s.wrap(raw[m]));
+
+    // all members are exchanged in one message per neighbor
+    auto batch = pattern.batch(members);
+    ASSERT_EQ(batch.size(), static_cast<std::size_t>(num_members));
+    auto plan = co.make_plan(batch.data(), batch.size());
+    for (int k=0; k<4; ++k)
+    {
+        for (int m=0; m<num_members; ++m) s.fill(members[m], 10*k+m);
+        if (k < 2)
+            co.exchange(batch.data(), batch.size()).wait();
+        else
+            plan.bexecute();
+        for (int m=0; m<num_members; ++m)
+            EXPECT_TRUE(s.check(members[m], halos, 10*k+m));
+    }
+}
@@ -0,0 +1,387 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2019, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include "./exchange_setup.hpp"
+#include <ghex/structured/staged_pattern.hpp>
+#include <ghex/structured/regions.hpp>
+#include <gtest/gtest.h>
+#include <functional>
+#include <algorithm>
+#include <vector>
+
+TEST(exchange_halos, reverse)
+{
+    exchange_setup s;
+    const std::array<int,6> halos{1,2,1,0,2,1};
+    auto pattern = s.make_pattern(halos);
+    auto co = gridtools::ghex::make_communication_object<decltype(pattern)>();
+
+    auto raw_a = s.make_raw_field();
+    auto raw_b = s.make_raw_field();
+    auto field_a = s.wrap(raw_a);
+    auto field_b = s.wrap(raw_b);
+
+    const auto& d = s.local_domains[0];
+    const std::array<int,3> g_ext{s.g_last[0]+1, s.g_last[1]+1, s.g_last[2]+1};
+    auto wrap = [&](int x, int dim) { return (x + g_ext[dim]) % g_ext[dim]; };
+    auto in_halo = [&](int x, int y, int z)
+    {
+        return x>=-halos[0] && x<s.local_ext[0]+halos[1] && y>=-halos[2] && y<s.local_ext[1]+halos[3] &&
+               z>=-halos[4] && z<s.local_ext[2]+halos[5] &&
+               !(x>=0 && x<s.local_ext[0] && y>=0 && y<s.local_ext[1] && z>=0 && z<s.local_ext[2]);
+    };
+    // number of halo points of all domains referring to each owned point
+    std::vector<int> counts(s.local_ext[0]*s.local_ext[1]*s.local_ext[2], 0);
+    for (int r=0; r<s.comm.size(); ++r)
+        for (int z=-2; z<s.local_ext[2]+2; ++z)
+            for (int y=-2; y<s.local_ext[1]+2; ++y)
+                for (int x=-2; x<s.local_ext[0]+2; ++x)
+                {
+                    if (!in_halo(x,y,z)) continue;
+                    const int xl = wrap(r*s.local_ext[0]+x, 0) - d.first()[0];
+                    if (xl < 0 || xl >= s.local_ext[0]) continue;
+                    ++counts[(wrap(z,2)*s.local_ext[1] + wrap(y,1))*s.local_ext[0] + xl];
+                }
+    // owned points hold their value, halo points the value of the point they refer to, the rest -1
+    auto fill = [&](auto& f, int k)
+    {
+        s.fill(f, k);
+        for (int z=-2; z<s.local_ext[2]+2; ++z)
+            for (int y=-2; y<s.local_ext[1]+2; ++y)
+                for (int x=-2; x<s.local_ext[0]+2; ++x)
+                    if (in_halo(x,y,z))
+                        f(x,y,z) = exchange_setup::value(wrap(d.first()[0]+x,0), wrap(y,1), wrap(z,2), k);
+    };
+    // owned points are combined with all their halo copies, everything else is unchanged
+    auto check = [&](const auto& f, int k, bool sum)
+    {
+        bool passed = true;
+        for (int z=-2; z<s.local_ext[2]+2; ++z)
+            for (int y=-2; y<s.local_ext[1]+2; ++y)
+                for (int x=-2; x<s.local_ext[0]+2; ++x)
+                {
+                    const int v = exchange_setup::value(wrap(d.first()[0]+x,0), wrap(y,1), wrap(z,2), k);
+                    if (x>=0 && x<s.local_ext[0] && y>=0 && y<s.local_ext[1] && z>=0 && z<s.local_ext[2])
+                    {
+                        const int n = counts[(z*s.local_ext[1] + y)*s.local_ext[0] + x];
+                        if (f(x,y,z) != (sum ? (n+1)*v : v)) passed = false;
+                    }
+                    else if (f(x,y,z) != (in_halo(x,y,z) ? v : -1))
+                        passed = false;
+                }
+        return passed;
+    };
+
+    for (std::size_t chunk_size : {std::size_t{0}, std::size_t{1}})
+    {
+        co.set_chunk_size(chunk_size);
+        fill(field_a, 1);
+        fill(field_b, 2);
+        co.reverse_exchange(std::plus<int>{}, pattern(field_a), pattern(field_b)).wait();
+        EXPECT_TRUE(check(field_a, 1, true));
+        EXPECT_TRUE(check(field_b, 2, true));
+    }
+    co.set_chunk_size(0);
+
+    // vector interface
+    std::vector<decltype(pattern(field_a))> bis{pattern(field_a)};
+    fill(field_a, 3);
+    co.reverse_exchange(std::plus<int>{}, bis.data(), bis.size()).wait();
+    EXPECT_TRUE(check(field_a, 3, true));
+
+    // the halo copies hold the same values as their owners, hence max leaves all values unchanged
+    auto plan = co.make_reverse_plan([](int a, int b) { return a > b ? a : b; }, pattern(field_a));
+    auto sum_plan = co.make_reverse_plan(std::plus<int>{}, pattern(field_b));
+    for (int k=0; k<2; ++k)
+    {
+        fill(field_a, k+4);
+        fill(field_b, k+6);
+        plan.bexecute();
+        sum_plan.bexecute();
+        EXPECT_TRUE(check(field_a, k+4, false));
+        EXPECT_TRUE(check(field_b, k+6, true));
+    }
+
+    // forward exchanges are not affected
+    s.fill(field_a, 8);
+    co.bexchange(pattern(field_a));
+    EXPECT_TRUE(s.check(field_a, halos, 8));
+}
+
+TEST(exchange_halos, halo_depth)
+{
+    exchange_setup s;
+    const std::array<int,6> halos{2,2,2,2,2,2};
+    const std::array<int,6> depth1{1,0,1,1,0,2};
+    const std::array<int,6> depth2{0,2,2,0,1,1};
+    auto pattern = s.make_pattern(halos);
+    auto co = gridtools::ghex::make_communication_object<decltype(pattern)>();
+
+    auto raw_a = s.make_raw_field();
+    auto raw_b = s.make_raw_field();
+    auto field_a = s.wrap(raw_a);
+    auto field_b = s.wrap(raw_b);
+
+    // points outside the requested layers are not touched
+    auto untouched = [&](const auto& f, const std::array<int,6>& depth)
+    {
+        bool passed = true;
+        for (int z=-2; z<s.local_ext[2]+2; ++z)
+            for (int y=-2; y<s.local_ext[1]+2; ++y)
+                for (int x=-2; x<s.local_ext[0]+2; ++x)
+                {
+                    const bool inside = x>=-depth[0] && x<s.local_ext[0]+depth[1] && y>=-depth[2] && 
+                        y<s.local_ext[1]+depth[3] && z>=-depth[4] && z<s.local_ext[2]+depth[5];
+                    if (!inside && f(x,y,z) != -1) passed = false;
+                }
+        return passed;
+    };
+    auto vec = [](const std::array<int,6>& a) { return std::vector<int>(a.begin(), a.end()); };
+
+    for (std::size_t chunk_size : {std::size_t{0}, std::size_t{1}})
+    {
+        co.set_chunk_size(chunk_size);
+        s.fill(field_a, 1);
+        s.fill(field_b, 2);
+        co.bexchange(pattern(field_a).halo_depth(vec(depth1)), pattern(field_b).halo_depth(vec(depth2)).use_datatype());
+        EXPECT_TRUE(s.check(field_a, depth1, 1));
+        EXPECT_TRUE(s.check(field_b, depth2, 2));
+        EXPECT_TRUE(untouched(field_a, depth1));
+        EXPECT_TRUE(untouched(field_b, depth2));
+    }
+    co.set_chunk_size(0);
+
+    // full halos by default
+    s.fill(field_a, 3);
+    co.bexchange(pattern(field_a));
+    EXPECT_TRUE(s.check(field_a, halos, 3));
+
+    // plans own the clipped halos
+    auto plan = co.make_plan(pattern(field_a).halo_depth(vec(depth2)), pattern(field_b).halo_depth(vec(depth1)));
+    for (int k=0; k<2; ++k)
+    {
+        s.fill(field_a, k+4);
+        s.fill(field_b, k+6);
+        plan.bexecute();
+        EXPECT_TRUE(s.check(field_a, depth2, k+4));
+        EXPECT_TRUE(s.check(field_b, depth1, k+6));
+        EXPECT_TRUE(untouched(field_a, depth2));
+        EXPECT_TRUE(untouched(field_b, depth1));
+    }
+
+    EXPECT_THROW((void)co.exchange(pattern(field_b), pattern(field_a).halo_depth({1,1})), std::runtime_error);
+
+    // a failed exchange leaves the communication object usable
+    s.fill(field_a, 8);
+    s.fill(field_b, 9);
+    co.bexchange(pattern(field_a).halo_depth(vec(depth1)), pattern(field_b));
+    EXPECT_TRUE(s.check(field_a, depth1, 8));
+    EXPECT_TRUE(s.check(field_b, halos, 9));
+}
+
+TEST(exchange_halos, halo_directions)
+{
+    exchange_setup s;
+    const std::array<int,6> halos{2,2,2,2,2,2};
+    auto pattern = s.make_pattern(halos);
+    auto co = gridtools::ghex::make_communication_object<decltype(pattern)>();
+
+    auto raw_a = s.make_raw_field();
+    auto raw_b = s.make_raw_field();
+    auto field_a = s.wrap(raw_a);
+    auto field_b = s.wrap(raw_b);
+
+    const auto faces = gridtools::ghex::structured::face_directions<3>();
+    const auto x_dir = gridtools::ghex::structured::axis_directions<3>(0);
+    const auto corners = gridtools::ghex::structured::make_direction_mask<3>(
+        [](const std::array<int,3>& dir) { return dir[0] != 0 && dir[1] != 0 && dir[2] != 0; });
+    EXPECT_EQ(faces.size(), 27u);
+    EXPECT_EQ(std::count(faces.begin(), faces.end(), true), 6);
+    EXPECT_EQ(std::count(x_dir.begin(), x_dir.end(), true), 2);
+    EXPECT_EQ(std::count(corners.begin(), corners.end(), true), 8);
+
+    // points within the given depth are exchanged if their direction is enabled, all others are untouched
+    auto check = [&](const auto& f, const std::array<int,6>& depth, const std::vector<bool>& mask, int k)
+    {
+        const auto& d = s.local_domains[0];
+        bool passed = true;
+        for (int z=-2; z<s.local_ext[2]+2; ++z)
+            for (int y=-2; y<s.local_ext[1]+2; ++y)
+                for (int x=-2; x<s.local_ext[0]+2; ++x)
+                {
+                    const std::array<int,3> x_l{x,y,z};
+                    std::array<int,3> dir;
+                    bool inside = true;
+                    for (int i=0; i<3; ++i)
+                    {
+                        dir[i] = x_l[i] < 0 ? -1 : (x_l[i] >= s.local_ext[i] ? 1 : 0);
+                        inside = inside && x_l[i] >= -depth[2*i] && x_l[i] < s.local_ext[i]+depth[2*i+1];
+                    }
+                    const bool exchanged = dir == std::array<int,3>{0,0,0} || 
+                        (inside && mask[gridtools::ghex::structured::direction_index(dir)]);
+                    const int xg = (d.first()[0]+x + s.g_last[0]+1)%(s.g_last[0]+1);
+                    const int yg = (y + s.g_last[1]+1)%(s.g_last[1]+1);
+                    const int zg = (z + s.g_last[2]+1)%(s.g_last[2]+1);
+                    if (f(x,y,z) != (exchanged ? exchange_setup::value(xg,yg,zg,k) : -1)) passed = false;
+                }
+        return passed;
+    };
+    auto vec = [](const std::array<int,6>& a) { return std::vector<int>(a.begin(), a.end()); };
+    const std::array<int,6> depth{1,2,2,1,0,2};
+
+    s.fill(field_a, 1);
+    s.fill(field_b, 2);
+    co.bexchange(pattern(field_a).halo_directions(faces), pattern(field_b).halo_directions(corners).use_datatype());
+    EXPECT_TRUE(check(field_a, halos, faces, 1));
+    EXPECT_TRUE(check(field_b, halos, corners, 2));
+
+    // combined with a halo depth
+    s.fill(field_a, 3);
+    co.bexchange(pattern(field_a).halo_directions(faces).halo_depth(vec(depth)));
+    EXPECT_TRUE(check(field_a, depth, faces, 3));
+
+    auto plan = co.make_plan(pattern(field_a).halo_directions(x_dir), pattern(field_b));
+    for (int k=0; k<2; ++k)
+    {
+        s.fill(field_a, k+4);
+        s.fill(field_b, k+6);
+        plan.bexecute();
+        EXPECT_TRUE(check(field_a, halos, x_dir, k+4));
+        EXPECT_TRUE(s.check(field_b, halos, k+6));
+    }
+
+    EXPECT_THROW((void)co.exchange(pattern(field_a).halo_directions({true,false})), std::runtime_error);
+}
+
+TEST(exchange_halos, staged)
+{
+    exchange_setup s;
+    const std::array<int,6> halos{1,2,2,1,1,1};
+    auto halo_gen = domain_descriptor_type::halo_generator_type(s.g_first, s.g_last, halos, s.periodic);
+    auto staged = gridtools::ghex::structured::make_staged_pattern(s.comm, halo_gen, s.local_domains);
+    auto co = gridtools::ghex::make_communication_object<typename decltype(staged)::pattern_container_type>();
+
+    // each stage exchanges the faces of one dimension only, edges and corners are forwarded
+    EXPECT_EQ(staged.size(), 3);
+    for (int i=0; i<staged.size(); ++i)
+        EXPECT_LE(staged[i][0].recv_halos().size(), 2u);
+
+    auto raw_a = s.make_raw_field();
+    auto raw_b = s.make_raw_field();
+    auto field_a = s.wrap(raw_a);
+    auto field_b = s.wrap(raw_b);
+
+    for (int k=0; k<2; ++k)
+    {
+        s.fill(field_a, k);
+        s.fill(field_b, k+2);
+        co.bexchange_staged(staged(field_a), staged(field_b));
+        EXPECT_TRUE(s.check(field_a, halos, k));
+        EXPECT_TRUE(s.check(field_b, halos, k+2));
+    }
+
+    // later stages span the halo layers of the previous dimensions, which are clipped as well
+    const std::array<int,6> depth{1,1,1,0,0,1};
+    auto clipped = [&](auto& field)
+    {
+        auto bis = staged(field);
+        for (auto& bi : bis) bi.halo_depth(std::vector<int>(depth.begin(), depth.end()));
+        return bis;
+    };
+    s.fill(field_a, 4);
+    co.bexchange_staged(clipped(field_a));
+    EXPECT_TRUE(s.check(field_a, depth, 4));
+    bool untouched = true;
+    for (int z=-2; z<s.local_ext[2]+2; ++z)
+        for (int y=-2; y<s.local_ext[1]+2; ++y)
+            for (int x=-2; x<s.local_ext[0]+2; ++x)
+            {
+                const bool inside = x>=-depth[0] && x<s.local_ext[0]+depth[1] && y>=-depth[2] && 
+                    y<s.local_ext[1]+depth[3] && z>=-depth[4] && z<s.local_ext[2]+depth[5];
+                if (!inside && field_a(x,y,z) != -1) untouched = false;
+            }
+    EXPECT_TRUE(untouched);
+
+    auto masked = staged(field_a);
+    masked[1].halo_directions(gridtools::ghex::structured::face_directions<3>());
+    EXPECT_THROW((void)co.exchange(masked[1]), std::runtime_error);
+
+    auto pattern = s.make_pattern(halos);
+    EXPECT_THROW(co.bexchange_staged(staged(field_a), std::vector<decltype(pattern(field_b))>{}), std::runtime_error);
+}
+
+TEST(exchange_halos, regions)
+{
+    exchange_setup s;
+    // no halos in y-direction
+    const std::array<int,6> halos{1,2,0,0,2,1};
+    const std::vector<int> radius{1,1,1,1,2,1};
+    auto pattern = s.make_pattern(halos);
+    auto co = gridtools::ghex::make_communication_object<decltype(pattern)>();
+    const auto regions = gridtools::ghex::structured::make_regions(pattern[0], radius);
+
+    // the domain is only shrunk on sides with halos
+    ASSERT_EQ(regions.interior.size(), 1u);
+    const auto& inner = regions.interior[0].local();
+    EXPECT_EQ(inner.first(), (std::array<int,3>{1,0,2}));
+    EXPECT_EQ(inner.last(),  (std::array<int,3>{s.local_ext[0]-2, s.local_ext[1]-1, s.local_ext[2]-2}));
+    EXPECT_EQ(regions.interior[0].global().first()[0], s.local_domains[0].first()[0]+1);
+
+    // interior and boundary cover the domain exactly once
+    std::vector<int> count(s.local_ext[0]*s.local_ext[1]*s.local_ext[2], 0);
+    auto cover = [&](const auto& is)
+    {
+        for (int z=is.local().first()[2]; z<=is.local().last()[2]; ++z)
+            for (int y=is.local().first()[1]; y<=is.local().last()[1]; ++y)
+                for (int x=is.local().first()[0]; x<=is.local().last()[0]; ++x)
+                    ++count[x + s.local_ext[0]*(y + s.local_ext[1]*z)];
+    };
+    for (const auto& is : regions.interior) cover(is);
+    for (const auto& is : regions.boundary) cover(is);
+    EXPECT_TRUE(std::all_of(count.begin(), count.end(), [](int c) { return c == 1; }));
+
+    // overlap a stencil in x and z with the exchange
+    auto raw = s.make_raw_field();
+    auto field = s.wrap(raw);
+    std::vector<int> result(count.size(), 0);
+    auto stencil = [&](const auto& is)
+    {
+        for (int z=is.local().first()[2]; z<=is.local().last()[2]; ++z)
+            for (int y=is.local().first()[1]; y<=is.local().last()[1]; ++y)
+                for (int x=is.local().first()[0]; x<=is.local().last()[0]; ++x)
+                    result[x + s.local_ext[0]*(y + s.local_ext[1]*z)] = 
+                        field(x-1,y,z) + field(x+1,y,z) + field(x,y,z-2) + field(x,y,z+1);
+    };
+    s.fill(field, 1);
+    auto h = co.exchange(pattern(field));
+    for (const auto& is : regions.interior) stencil(is);
+    h.wait();
+    for (const auto& is : regions.boundary) stencil(is);
+    bool passed = true;
+    const auto& d = s.local_domains[0];
+    auto value = [&](int x, int y, int z)
+    {
+        return exchange_setup::value((d.first()[0]+x + s.g_last[0]+1)%(s.g_last[0]+1), y, (z + s.g_last[2]+1)%(s.g_last[2]+1), 1);
+    };
+    for (int z=0; z<s.local_ext[2]; ++z)
+        for (int y=0; y<s.local_ext[1]; ++y)
+            for (int x=0; x<s.local_ext[0]; ++x)
+                if (result[x + s.local_ext[0]*(y + s.local_ext[1]*z)] != 
+                    value(x-1,y,z) + value(x+1,y,z) + value(x,y,z-2) + value(x,y,z+1)) passed = false;
+    EXPECT_TRUE(passed);
+
+    // domains smaller than the stencil have no interior
+    const auto wide = gridtools::ghex::structured::make_regions(pattern[0], 4);
+    EXPECT_TRUE(wide.interior.empty());
+    ASSERT_EQ(wide.boundary.size(), 1u);
+    EXPECT_EQ(wide.boundary[0].size(), s.local_ext[0]*s.local_ext[1]*s.local_ext[2]);
+    EXPECT_THROW(gridtools::ghex::structured::make_regions(pattern[0], std::vector<int>{1,1}), std::runtime_error);
+}
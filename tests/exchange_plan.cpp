@@ -0,0 +1,255 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2019, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include "./exchange_setup.hpp"
+#include <gtest/gtest.h>
+
+TEST(exchange_plan, execute)
+{
+    exchange_setup s;
+    const std::array<int,6> halos1{1,1,1,1,1,1};
+    const std::array<int,6> halos2{2,1,0,2,1,0};
+    auto pattern1 = s.make_pattern(halos1);
+    auto pattern2 = s.make_pattern(halos2);
+    auto co = gridtools::ghex::make_communication_object<decltype(pattern1)>();
+
+    auto raw_a = s.make_raw_field();
+    auto raw_b = s.make_raw_field();
+    auto field_a = s.wrap(raw_a);
+    auto field_b = s.wrap(raw_b);
+
+    auto plan = co.make_plan(pattern1(field_a), pattern2(field_b));
+    for (int k=0; k<3; ++k)
+    {
+        s.fill(field_a, k);
+        s.fill(field_b, k+10);
+        auto h = plan.execute();
+        EXPECT_THROW((void)plan.execute(), std::runtime_error);
+        h.wait();
+        EXPECT_TRUE(s.check(field_a, halos1, k));
+        EXPECT_TRUE(s.check(field_b, halos2, k+10));
+    }
+
+    // the communication object is still usable after compiling a plan
+    s.fill(field_a, 5);
+    co.bexchange(pattern1(field_a));
+    EXPECT_TRUE(s.check(field_a, halos1, 5));
+}
+
+TEST(exchange_plan, alongside_exchanges)
+{
+    exchange_setup s;
+    const std::array<int,6> halos{1,1,1,1,1,1};
+    auto pattern = s.make_pattern(halos);
+    auto co = gridtools::ghex::make_communication_object<decltype(pattern)>();
+    co.set_max_in_flight(2);
+
+    auto raw_a = s.make_raw_field();
+    auto raw_b = s.make_raw_field();
+    auto raw_c = s.make_raw_field();
+    auto raw_d = s.make_raw_field();
+    auto field_a = s.wrap(raw_a);
+    auto field_b = s.wrap(raw_b);
+    auto field_c = s.wrap(raw_c);
+    auto field_d = s.wrap(raw_d);
+
+    // plans and exchanges of the same pattern use disjoint tags: the ranks may start plans and exchanges in
+    // different order
+    auto plan_a = co.make_plan(pattern(field_a));
+    auto plan_b = co.make_plan(pattern(field_b));
+    const bool plans_first = s.comm.rank()%2 == 0;
+    for (int k=0; k<3; ++k)
+    {
+        s.fill(field_a, k);
+        s.fill(field_b, k+10);
+        s.fill(field_c, k+20);
+        s.fill(field_d, k+30);
+        if (plans_first)
+        {
+            auto h_a = plan_a.execute();
+            auto h_b = plan_b.execute();
+            auto h_c = co.exchange(pattern(field_c));
+            auto h_d = co.exchange(pattern(field_d));
+            h_a.wait(); h_b.wait(); h_c.wait(); h_d.wait();
+        }
+        else
+        {
+            auto h_c = co.exchange(pattern(field_c));
+            auto h_d = co.exchange(pattern(field_d));
+            auto h_b = plan_b.execute();
+            auto h_a = plan_a.execute();
+            h_a.wait(); h_b.wait(); h_c.wait(); h_d.wait();
+        }
+        EXPECT_TRUE(s.check(field_a, halos, k));
+        EXPECT_TRUE(s.check(field_b, halos, k+10));
+        EXPECT_TRUE(s.check(field_c, halos, k+20));
+        EXPECT_TRUE(s.check(field_d, halos, k+30));
+    }
+}
+
+TEST(exchange_plan, execute_vector)
+{
+    exchange_setup s;
+    const std::array<int,6> halos{2,2,2,2,2,2};
+    auto pattern = s.make_pattern(halos);
+    auto co = gridtools::ghex::make_communication_object<decltype(pattern)>();
+
+    auto raw_a = s.make_raw_field();
+    auto raw_b = s.make_raw_field();
+    auto field_a = s.wrap(raw_a);
+    auto field_b = s.wrap(raw_b);
+
+    std::vector<decltype(pattern(field_a))> bis{pattern(field_a), pattern(field_b)};
+    auto plan = co.make_plan(bis.data(), bis.size());
+    for (int k=0; k<3; ++k)
+    {
+        s.fill(field_a, k);
+        s.fill(field_b, k+10);
+        plan.bexecute();
+        EXPECT_TRUE(s.check(field_a, halos, k));
+        EXPECT_TRUE(s.check(field_b, halos, k+10));
+    }
+}
+
+TEST(exchange_plan, progress)
+{
+    exchange_setup s;
+    const std::array<int,6> halos{1,2,1,2,1,2};
+    auto pattern = s.make_pattern(halos);
+    auto co = gridtools::ghex::make_communication_object<decltype(pattern)>();
+
+    auto raw_a = s.make_raw_field();
+    auto field_a = s.wrap(raw_a);
+
+    // progress a planned exchange until completion
+    auto plan = co.make_plan(pattern(field_a));
+    for (int k=0; k<3; ++k)
+    {
+        s.fill(field_a, k);
+        auto h = plan.execute();
+        while (!h.progress()) {}
+        EXPECT_TRUE(h.test());
+        EXPECT_TRUE(s.check(field_a, halos, k));
+        // handle is ready, wait is a no-op
+        h.wait();
+    }
+
+    // progress a regular exchange until completion
+    s.fill(field_a, 7);
+    auto h = co.exchange(pattern(field_a));
+    while (!h.test()) {}
+    EXPECT_TRUE(s.check(field_a, halos, 7));
+    // the communication object is ready again
+    co.bexchange(pattern(field_a));
+    EXPECT_TRUE(s.check(field_a, halos, 7));
+}
+
+TEST(exchange_plan, prepost)
+{
+    exchange_setup s;
+    const std::array<int,6> halos1{1,1,1,1,1,1};
+    const std::array<int,6> halos2{2,1,0,2,1,0};
+    auto pattern1 = s.make_pattern(halos1);
+    auto pattern2 = s.make_pattern(halos2);
+    auto co = gridtools::ghex::make_communication_object<decltype(pattern1)>();
+
+    auto raw_a = s.make_raw_field();
+    auto raw_b = s.make_raw_field();
+    auto field_a = s.wrap(raw_a);
+    auto field_b = s.wrap(raw_b);
+
+    // buffers holding field b, which is received directly into field memory, are posted on execution
+    auto plan = co.make_plan(pattern1(field_a), pattern2(field_b).use_datatype());
+    EXPECT_FALSE(plan.prepost_enabled());
+    plan.set_prepost(true);
+    EXPECT_TRUE(plan.prepost_enabled());
+    for (int k=0; k<3; ++k)
+    {
+        s.fill(field_a, k);
+        s.fill(field_b, k+10);
+        auto h = plan.execute();
+        if (k%2) 
+            h.wait();
+        else 
+            while (!h.test()) {}
+        EXPECT_TRUE(s.check(field_a, halos1, k));
+        EXPECT_TRUE(s.check(field_b, halos2, k+10));
+    }
+
+    // receives posted ahead are cancelled before the tags are reused by another plan
+    plan.set_prepost(false);
+    MPI_Barrier(MPI_COMM_WORLD);
+    plan = co.make_plan(pattern2(field_a));
+    plan.set_prepost(true);
+    for (int k=0; k<2; ++k)
+    {
+        s.fill(field_a, k+20);
+        plan.bexecute();
+        EXPECT_TRUE(s.check(field_a, halos2, k+20));
+    }
+    plan.set_prepost(false);
+    MPI_Barrier(MPI_COMM_WORLD);
+}
+
+TEST(exchange_plan, deep_halo)
+{
+    exchange_setup s;
+    const std::array<int,6> halos{2,2,2,2,2,2};
+    auto pattern = s.make_pattern(halos);
+    auto co = gridtools::ghex::make_communication_object<decltype(pattern)>();
+
+    auto raw = s.make_raw_field();
+    auto raw_tmp = s.make_raw_field();
+    auto field = s.wrap(raw);
+    auto tmp = s.wrap(raw_tmp);
+    s.fill(field, 1);
+
+    // shift by one point in x-direction per step (stencil radius 1), exchange every other step
+    auto plan = co.make_plan(pattern(field));
+    EXPECT_EQ(plan.halo_width(), 2);
+    EXPECT_EQ(plan.valid_depth(), 0);
+    int num_exchanges = 0;
+    const int num_steps = 4;
+    for (int n=0; n<num_steps; ++n)
+    {
+        if (plan.require(1)) ++num_exchanges;
+        const int extra = plan.valid_depth()-1;
+        raw_tmp = raw;
+        for (int z=0; z<s.local_ext[2]; ++z)
+            for (int y=0; y<s.local_ext[1]; ++y)
+                for (int x=-extra; x<s.local_ext[0]+extra; ++x)
+                    field(x,y,z) = tmp(x-1,y,z);
+        plan.consume(1);
+    }
+    EXPECT_EQ(num_exchanges, num_steps/2);
+    EXPECT_EQ(plan.valid_depth(), 0);
+
+    const auto& d = s.local_domains[0];
+    bool passed = true;
+    for (int z=0; z<s.local_ext[2]; ++z)
+        for (int y=0; y<s.local_ext[1]; ++y)
+            for (int x=0; x<s.local_ext[0]; ++x)
+            {
+                const int xg = (d.first()[0]+x-num_steps + s.g_last[0]+1)%(s.g_last[0]+1);
+                if (field(x,y,z) != exchange_setup::value(xg,y,z,1)) passed = false;
+            }
+    EXPECT_TRUE(passed);
+
+    EXPECT_THROW(plan.require(3), std::runtime_error);
+    EXPECT_THROW(plan.set_halo_width(-1), std::runtime_error);
+    plan.set_halo_width(1);
+    EXPECT_EQ(plan.halo_width(), 1);
+
+    // the width defaults to the shallowest direction with halos
+    auto pattern2 = s.make_pattern({2,1,1,2,1,0});
+    auto plan2 = co.make_plan(pattern2(field));
+    EXPECT_EQ(plan2.halo_width(), 1);
+}
@@ -0,0 +1,314 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2019, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include "./exchange_setup.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+TEST(exchange_scheduling, in_flight)
+{
+    exchange_setup s;
+    const std::array<int,6> halos1{2,1,1,2,1,0};
+    const std::array<int,6> halos2{1,1,2,2,0,1};
+    auto pattern1 = s.make_pattern(halos1);
+    auto pattern2 = s.make_pattern(halos2);
+    auto co = gridtools::ghex::make_communication_object<decltype(pattern1)>();
+    EXPECT_EQ(co.max_in_flight(), 1);
+    EXPECT_THROW(co.set_max_in_flight(0), std::runtime_error);
+    co.set_max_in_flight(2);
+    EXPECT_EQ(co.max_in_flight(), 2);
+
+    auto raw_a = s.make_raw_field();
+    auto raw_b = s.make_raw_field();
+    auto raw_c = s.make_raw_field();
+    auto field_a = s.wrap(raw_a);
+    auto field_b = s.wrap(raw_b);
+    auto field_c = s.wrap(raw_c);
+
+    for (int k=0; k<2; ++k)
+    {
+        // two groups of fields in flight at once, finished in reverse order
+        s.fill(field_a, k);
+        s.fill(field_b, k+2);
+        s.fill(field_c, k+4);
+        auto h1 = co.exchange(pattern1(field_a), pattern2(field_b));
+        auto h2 = co.exchange(pattern1(field_c));
+        EXPECT_THROW((void)co.exchange(pattern2(field_a)), std::runtime_error);
+        EXPECT_THROW(co.set_max_in_flight(1), std::runtime_error);
+        h2.wait();
+        EXPECT_TRUE(s.check(field_c, halos1, k+4));
+        while (!h1.test()) {}
+        EXPECT_TRUE(s.check(field_a, halos1, k));
+        EXPECT_TRUE(s.check(field_b, halos2, k+2));
+    }
+
+    // a finished exchange frees its buffers for the exchange started two exchanges later
+    s.fill(field_a, 6);
+    s.fill(field_b, 7);
+    auto h1 = co.exchange(pattern1(field_a));
+    co.bexchange(pattern2(field_b));
+    EXPECT_TRUE(s.check(field_b, halos2, 7));
+    EXPECT_THROW((void)co.exchange(pattern1(field_c)), std::runtime_error);
+    h1.wait();
+    EXPECT_TRUE(s.check(field_a, halos1, 6));
+    s.fill(field_c, 8);
+    co.bexchange(pattern1(field_c));
+    EXPECT_TRUE(s.check(field_c, halos1, 8));
+}
+
+TEST(exchange_scheduling, double_buffering)
+{
+    exchange_setup s;
+    const std::array<int,6> halos{2,1,1,2,1,0};
+    auto pattern = s.make_pattern(halos);
+    auto co = gridtools::ghex::make_communication_object<decltype(pattern)>();
+    co.set_double_buffering(true);
+    EXPECT_TRUE(co.double_buffering());
+
+    auto raw_a = s.make_raw_field();
+    auto raw_b = s.make_raw_field();
+    auto field_a = s.wrap(raw_a);
+    auto field_b = s.wrap(raw_b);
+
+    // consecutive exchanges alternate between the two buffer sets
+    for (int k=0; k<4; ++k)
+    {
+        s.fill(field_a, k);
+        s.fill(field_b, k+4);
+        co.bexchange(pattern(field_a), pattern(field_b));
+        EXPECT_TRUE(s.check(field_a, halos, k));
+        EXPECT_TRUE(s.check(field_b, halos, k+4));
+    }
+    for (int k=0; k<3; ++k)
+    {
+        s.fill(field_a, k+8);
+        auto h = co.exchange(pattern(field_a));
+        while (!h.test()) {}
+        EXPECT_TRUE(s.check(field_a, halos, k+8));
+    }
+
+    // combined with several exchanges in flight
+    co.set_max_in_flight(2);
+    for (int k=0; k<3; ++k)
+    {
+        s.fill(field_a, k+12);
+        s.fill(field_b, k+16);
+        auto h1 = co.exchange(pattern(field_a));
+        auto h2 = co.exchange(pattern(field_b));
+        h1.wait();
+        h2.wait();
+        EXPECT_TRUE(s.check(field_a, halos, k+12));
+        EXPECT_TRUE(s.check(field_b, halos, k+16));
+    }
+
+    EXPECT_THROW((void)co.exchange(pattern(field_a).use_datatype()), std::runtime_error);
+    co.set_double_buffering(false);
+    s.fill(field_a, 20);
+    co.bexchange(pattern(field_a).use_datatype());
+    EXPECT_TRUE(s.check(field_a, halos, 20));
+}
+
+TEST(exchange_scheduling, reserve)
+{
+    exchange_setup s;
+    const std::array<int,6> halos1{2,1,1,2,1,0};
+    const std::array<int,6> halos2{1,1,2,2,0,1};
+    auto pattern1 = s.make_pattern(halos1);
+    auto pattern2 = s.make_pattern(halos2);
+    auto co = gridtools::ghex::make_communication_object<decltype(pattern1)>();
+    co.set_max_in_flight(2);
+    co.set_double_buffering(true);
+
+    auto raw_a = s.make_raw_field();
+    auto raw_b = s.make_raw_field();
+    auto field_a = s.wrap(raw_a);
+    auto field_b = s.wrap(raw_b);
+
+    co.reserve(pattern1(field_a), pattern2(field_b));
+    std::vector<decltype(pattern1(field_a))> bis{pattern1(field_a)};
+    co.reserve(bis.data(), bis.size());
+    for (int k=0; k<4; ++k)
+    {
+        s.fill(field_a, k);
+        s.fill(field_b, k+4);
+        co.bexchange(pattern1(field_a), pattern2(field_b));
+        EXPECT_TRUE(s.check(field_a, halos1, k));
+        EXPECT_TRUE(s.check(field_b, halos2, k+4));
+    }
+
+    // reserving waits for the sends of the double buffered exchanges, and does not change the order in which
+    // the exchanges take their buffers and tags
+    auto h = co.exchange(pattern1(field_a));
+    EXPECT_THROW(co.reserve(pattern1(field_a)), std::runtime_error);
+    h.wait();
+    co.reserve(pattern1(field_a));
+    s.fill(field_a, 8);
+    co.bexchange(pattern1(field_a));
+    EXPECT_TRUE(s.check(field_a, halos1, 8));
+}
+
+TEST(exchange_scheduling, neighbor_continuation)
+{
+    exchange_setup s;
+    const std::array<int,6> halos1{2,1,1,2,1,0};
+    const std::array<int,6> halos2{1,1,2,2,0,1};
+    auto pattern1 = s.make_pattern(halos1);
+    auto pattern2 = s.make_pattern(halos2);
+    auto co = gridtools::ghex::make_communication_object<decltype(pattern1)>();
+    co.set_chunk_size(64);
+
+    auto raw_a = s.make_raw_field();
+    auto raw_b = s.make_raw_field();
+    auto field_a = s.wrap(raw_a);
+    auto field_b = s.wrap(raw_b);
+
+    // the halos received from a neighbor are complete when it is reported
+    auto complete = [&](const auto& f, const auto& pattern, int neighbor, int k)
+    {
+        const auto& d = s.local_domains[0];
+        bool passed = true;
+        for (const auto& p : pattern[0].recv_halos())
+        {
+            if (p.first.id != neighbor) continue;
+            for (const auto& is : p.second)
+                for (int z=is.local().first()[2]; z<=is.local().last()[2]; ++z)
+                    for (int y=is.local().first()[1]; y<=is.local().last()[1]; ++y)
+                        for (int x=is.local().first()[0]; x<=is.local().last()[0]; ++x)
+                        {
+                            const int xg = (d.first()[0]+x + s.g_last[0]+1)%(s.g_last[0]+1);
+                            const int yg = (y + s.g_last[1]+1)%(s.g_last[1]+1);
+                            const int zg = (z + s.g_last[2]+1)%(s.g_last[2]+1);
+                            if (f(x,y,z) != exchange_setup::value(xg,yg,zg,k)) passed = false;
+                        }
+        }
+        return passed;
+    };
+    auto neighbors = [](const auto& pattern)
+    {
+        std::vector<int> ids;
+        for (const auto& p : pattern[0].recv_halos()) ids.push_back(p.first.id);
+        std::sort(ids.begin(), ids.end());
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+        return ids;
+    };
+
+    auto plan = co.make_plan(pattern1(field_a), pattern2(field_b));
+    for (int k=0; k<4; ++k)
+    {
+        s.fill(field_a, k);
+        s.fill(field_b, k+4);
+        std::vector<int> reported;
+        auto h = (k < 2) ? co.exchange(pattern1(field_a), pattern2(field_b)) : plan.execute();
+        h.wait([&](int local_id, int neighbor_id)
+        {
+            EXPECT_EQ(local_id, s.local_domains[0].domain_id());
+            EXPECT_TRUE(complete(field_a, pattern1, neighbor_id, k));
+            EXPECT_TRUE(complete(field_b, pattern2, neighbor_id, k+4));
+            reported.push_back(neighbor_id);
+        });
+        std::sort(reported.begin(), reported.end());
+        EXPECT_EQ(reported, neighbors(pattern1));
+        EXPECT_TRUE(s.check(field_a, halos1, k));
+        EXPECT_TRUE(s.check(field_b, halos2, k+4));
+    }
+
+    // a neighbor is reported before the remaining messages have arrived: the last rank starts its exchange only
+    // once rank 0 signals that it has been notified about rank 1 (the last rank proceeds after a timeout
+    // otherwise, such that the test fails instead of hanging)
+    const int size = s.comm.size();
+    const int rank = s.comm.rank();
+    if (size < 3) return;
+    MPI_Comm signal_comm;
+    MPI_Comm_dup(s.mpi_comm, &signal_comm);
+    for (int k=0; k<2; ++k)
+    {
+        s.fill(field_a, k+8);
+        s.fill(field_b, k+12);
+        int signal = 0;
+        bool signalled = false;
+        if (rank == size-1)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            while (!signalled && std::chrono::steady_clock::now() - start < std::chrono::seconds(30))
+            {
+                int flag = 0;
+                MPI_Iprobe(0, k, signal_comm, &flag, MPI_STATUS_IGNORE);
+                signalled = flag;
+            }
+            EXPECT_TRUE(signalled);
+        }
+        auto h = (k == 0) ? co.exchange(pattern1(field_a), pattern2(field_b)) : plan.execute();
+        h.wait([&](int, int neighbor_id)
+        {
+            if (rank == 0 && neighbor_id == 1) MPI_Send(&signal, 1, MPI_INT, size-1, k, signal_comm);
+        });
+        if (rank == size-1) MPI_Recv(&signal, 1, MPI_INT, 0, k, signal_comm, MPI_STATUS_IGNORE);
+        EXPECT_TRUE(s.check(field_a, halos1, k+8));
+        EXPECT_TRUE(s.check(field_b, halos2, k+12));
+    }
+    MPI_Comm_free(&signal_comm);
+}
+
+TEST(exchange_scheduling, reduction)
+{
+    exchange_setup s;
+    const std::array<int,6> halos{2,1,1,2,1,0};
+    auto pattern = s.make_pattern(halos);
+    auto co = gridtools::ghex::make_communication_object<decltype(pattern)>();
+
+    auto raw = s.make_raw_field();
+    auto field = s.wrap(raw);
+    const int size = s.comm.size();
+    const int rank = s.comm.rank();
+
+    auto plan = co.make_plan(pattern(field));
+    for (int k=0; k<4; ++k)
+    {
+        s.fill(field, k);
+        double norms[2] = {1.0*rank, 2.0*k};
+        double sums[2] = {0.0, 0.0};
+        int max = rank+k;
+        if (k < 2)
+        {
+            co.allreduce(norms, sums, 2, MPI_SUM);
+            // a pending reduction is not replaced
+            EXPECT_THROW(co.allreduce(&max, &max, 1, MPI_MAX), std::runtime_error);
+            auto h = co.exchange(pattern(field));
+            // the reduction is only attached to one exchange
+            co.allreduce(&max, &max, 1, MPI_MAX);
+            if (k%2) 
+                h.wait();
+            else 
+                while (!h.test()) {}
+            co.bexchange(pattern(field));
+        }
+        else
+        {
+            plan.allreduce(norms, sums, 2, MPI_SUM);
+            EXPECT_THROW(plan.allreduce(&max, &max, 1, MPI_MAX), std::runtime_error);
+            if (k%2)
+                plan.bexecute();
+            else
+            {
+                auto h = plan.execute();
+                while (!h.test()) {}
+            }
+            plan.allreduce(&max, &max, 1, MPI_MAX);
+            plan.bexecute();
+        }
+        EXPECT_TRUE(s.check(field, halos, k));
+        EXPECT_EQ(sums[0], 0.5*size*(size-1));
+        EXPECT_EQ(sums[1], 2.0*k*size);
+        EXPECT_EQ(max, size-1+k);
+    }
+}
@@ -0,0 +1,113 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2019, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef INCLUDED_GHEX_TESTS_EXCHANGE_SETUP_HPP
+#define INCLUDED_GHEX_TESTS_EXCHANGE_SETUP_HPP
+
+#include <ghex/structured/pattern.hpp>
+#include <ghex/communication_object_2.hpp>
+#include <ghex/transport_layer/mpi/communicator.hpp>
+#include <array>
+#include <vector>
+
+using domain_descriptor_type = gridtools::ghex::structured::domain_descriptor<int,3>;
+
+// decomposition: one domain per rank, domains are stacked in x-direction, periodic in all directions
+struct exchange_setup
+{
+    gridtools::ghex::tl::mpi::communicator_base mpi_comm;
+    gridtools::ghex::tl::communicator<gridtools::ghex::tl::mpi_tag> comm{mpi_comm};
+    const std::array<int,3> local_ext{8,6,5};
+    const std::array<int,3> halo_ext{2,2,2};
+    const std::array<int,3> buffer_ext{local_ext[0]+2*halo_ext[0], local_ext[1]+2*halo_ext[1], local_ext[2]+2*halo_ext[2]};
+    const std::array<int,3> g_first{0,0,0};
+    const std::array<int,3> g_last{local_ext[0]*comm.size()-1, local_ext[1]-1, local_ext[2]-1};
+    const std::array<bool,3> periodic{true,true,true};
+    std::vector<domain_descriptor_type> local_domains{ domain_descriptor_type{
+        comm.rank(),
+        std::array<int,3>{comm.rank()*local_ext[0], 0, 0},
+        std::array<int,3>{(comm.rank()+1)*local_ext[0]-1, local_ext[1]-1, local_ext[2]-1}} };
+
+    auto make_pattern(const std::array<int,6>& halos)
+    {
+        auto halo_gen = domain_descriptor_type::halo_generator_type(g_first, g_last, halos, periodic);
+        return gridtools::ghex::make_pattern<gridtools::ghex::structured::grid>(comm, halo_gen, local_domains);
+    }
+
+    std::vector<int> make_raw_field() const
+    {
+        return std::vector<int>(buffer_ext[0]*buffer_ext[1]*buffer_ext[2]);
+    }
+
+    auto wrap(std::vector<int>& raw) const
+    {
+        return gridtools::ghex::wrap_field<gridtools::ghex::cpu,2,1,0>(local_domains[0].domain_id(), raw.data(), halo_ext, buffer_ext);
+    }
+
+    static int value(int x, int y, int z, int k) { return k*1000000 + x*10000 + y*100 + z; }
+
+    // fill the interior with global coordinates and the halo regions with -1
+    template<typename Field>
+    void fill(Field& f, int k) const
+    {
+        const auto& d = local_domains[0];
+        for (int z=-halo_ext[2]; z<local_ext[2]+halo_ext[2]; ++z)
+            for (int y=-halo_ext[1]; y<local_ext[1]+halo_ext[1]; ++y)
+                for (int x=-halo_ext[0]; x<local_ext[0]+halo_ext[0]; ++x)
+                {
+                    const bool inner = x>=0 && x<local_ext[0] && y>=0 && y<local_ext[1] && z>=0 && z<local_ext[2];
+                    f(x,y,z) = inner ? value(d.first()[0]+x, d.first()[1]+y, d.first()[2]+z, k) : -1;
+                }
+    }
+
+    // check all points within the given halos against the expected (wrapped) global coordinates
+    template<typename Field>
+    bool check(const Field& f, const std::array<int,6>& halos, int k) const
+    {
+        const auto& d = local_domains[0];
+        bool passed = true;
+        for (int z=-halos[4]; z<local_ext[2]+halos[5]; ++z)
+            for (int y=-halos[2]; y<local_ext[1]+halos[3]; ++y)
+                for (int x=-halos[0]; x<local_ext[0]+halos[1]; ++x)
+                {
+                    const int xg = (d.first()[0]+x + g_last[0]+1)%(g_last[0]+1);
+                    const int yg = (d.first()[1]+y + g_last[1]+1)%(g_last[1]+1);
+                    const int zg = (d.first()[2]+z + g_last[2]+1)%(g_last[2]+1);
+                    if (f(x,y,z) != value(xg,yg,zg,k)) passed = false;
+                }
+        return passed;
+    }
+};
+
+// field which counts how often it is packed and unpacked
+template<typename Field>
+struct counting_field : public Field
+{
+    int num_packed = 0;
+    int num_unpacked = 0;
+
+    counting_field(const Field& f) : Field(f) {}
+
+    template<typename IndexContainer>
+    void pack(typename Field::value_type* buffer, const IndexContainer& c, void* arg)
+    {
+        ++num_packed;
+        Field::pack(buffer, c, arg);
+    }
+
+    template<typename IndexContainer>
+    void unpack(const typename Field::value_type* buffer, const IndexContainer& c, void* arg)
+    {
+        ++num_unpacked;
+        Field::unpack(buffer, c, arg);
+    }
+};
+
+#endif /* INCLUDED_GHEX_TESTS_EXCHANGE_SETUP_HPP */
@@ -0,0 +1,178 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2019, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include "./exchange_setup.hpp"
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+TEST(exchange_threads, thread_pool)
+{
+    exchange_setup s;
+    const std::array<int,6> halos1{1,1,1,1,1,1};
+    const std::array<int,6> halos2{2,2,2,2,2,2};
+    auto pattern1 = s.make_pattern(halos1);
+    auto pattern2 = s.make_pattern(halos2);
+    auto co = gridtools::ghex::make_communication_object<decltype(pattern1)>();
+    gridtools::ghex::thread_pool pool(3);
+    co.set_thread_pool(&pool);
+    EXPECT_EQ(co.get_thread_pool(), &pool);
+
+    auto raw_a = s.make_raw_field();
+    auto raw_b = s.make_raw_field();
+    auto field_a = s.wrap(raw_a);
+    auto field_b = s.wrap(raw_b);
+
+    for (std::size_t chunk_size : {std::size_t{0}, std::size_t{1}})
+    {
+        co.set_chunk_size(chunk_size);
+        s.fill(field_a, 1);
+        s.fill(field_b, 2);
+        co.bexchange(pattern1(field_a), pattern2(field_b));
+        EXPECT_TRUE(s.check(field_a, halos1, 1));
+        EXPECT_TRUE(s.check(field_b, halos2, 2));
+
+        s.fill(field_a, 3);
+        s.fill(field_b, 4);
+        auto h = co.exchange(pattern1(field_a), pattern2(field_b));
+        while (!h.progress()) {}
+        EXPECT_TRUE(s.check(field_a, halos1, 3));
+        EXPECT_TRUE(s.check(field_b, halos2, 4));
+    }
+
+    auto plan = co.make_plan(pattern1(field_a), pattern2(field_b));
+    for (int k=0; k<2; ++k)
+    {
+        s.fill(field_a, k+5);
+        s.fill(field_b, k+6);
+        plan.bexecute();
+        EXPECT_TRUE(s.check(field_a, halos1, k+5));
+        EXPECT_TRUE(s.check(field_b, halos2, k+6));
+    }
+}
+
+TEST(exchange_threads, concurrent_threads)
+{
+    exchange_setup s;
+    const std::array<int,6> halos{2,1,2,1,2,1};
+    auto pattern = s.make_pattern(halos);
+    using co_type = decltype(gridtools::ghex::make_communication_object<decltype(pattern)>());
+    const int num_threads = 4;
+
+    // one communication object per thread with disjoint tag ranges
+    std::vector<co_type> cos;
+    for (int i=0; i<num_threads; ++i)
+        cos.push_back(gridtools::ghex::make_communication_object<decltype(pattern)>(gridtools::ghex::auto_id, s.comm));
+    for (int i=1; i<num_threads; ++i)
+    {
+        EXPECT_NE(cos[i].id(), cos[i-1].id());
+        EXPECT_LE(cos[i].tag_offset()+cos[i].tag_range(), cos[i-1].tag_offset());
+    }
+    // the default object uses the tags below
+    auto co = gridtools::ghex::make_communication_object<decltype(pattern)>();
+    EXPECT_EQ(co.tag_offset(), 0);
+    EXPECT_LE(co.tag_range(), cos[num_threads-1].tag_offset());
+
+    std::vector<std::vector<int>> raw(num_threads);
+    std::vector<decltype(s.wrap(raw[0]))> fields;
+    for (int i=0; i<num_threads; ++i)
+    {
+        raw[i] = s.make_raw_field();
+        fields.push_back(s.wrap(raw[i]));
+    }
+
+    // all threads exchange a field of the same pattern and domain concurrently
+    std::vector<int> passed(num_threads, 1);
+    std::vector<std::thread> threads;
+    for (int i=0; i<num_threads; ++i)
+        threads.push_back(std::thread([&s,&pattern,&fields,&cos,&passed,&halos,i]()
+        {
+            for (int k=0; k<3; ++k)
+            {
+                s.fill(fields[i], 10*i+k);
+                cos[i].bexchange(pattern(fields[i]));
+                passed[i] = passed[i] && s.check(fields[i], halos, 10*i+k);
+            }
+        }));
+    for (auto& t : threads) t.join();
+    for (int i=0; i<num_threads; ++i)
+        EXPECT_TRUE(passed[i]);
+}
+
+TEST(exchange_threads, tag_slots)
+{
+    exchange_setup s;
+    const std::array<int,6> halos{1,1,1,1,1,1};
+    auto pattern = s.make_pattern(halos);
+    using co_type = decltype(gridtools::ghex::make_communication_object<decltype(pattern)>());
+    const int n = co_type::num_tag_slots;
+
+    auto co_0 = gridtools::ghex::make_communication_object<decltype(pattern)>();
+    const auto full_range = co_0.tag_range();
+    {
+        // ids are not wrapped around
+        EXPECT_THROW(gridtools::ghex::make_communication_object<decltype(pattern)>(n), std::runtime_error);
+        EXPECT_THROW(gridtools::ghex::make_communication_object<decltype(pattern)>(-1), std::runtime_error);
+
+        // explicit ids may be shared, automatic ones are unique
+        auto co_1 = gridtools::ghex::make_communication_object<decltype(pattern)>(1);
+        auto co_1b = gridtools::ghex::make_communication_object<decltype(pattern)>(1);
+        EXPECT_EQ(co_1.tag_offset(), co_1b.tag_offset());
+        auto co_2 = gridtools::ghex::make_communication_object<decltype(pattern)>(gridtools::ghex::auto_id, s.comm);
+        EXPECT_EQ(co_2.id(), 2);
+        EXPECT_THROW(gridtools::ghex::make_communication_object<decltype(pattern)>(2), std::runtime_error);
+        // the range of id 0 does not depend on the live objects
+        EXPECT_EQ(co_0.tag_range(), full_range);
+
+        // all of them exchange concurrently
+        auto raw_0 = s.make_raw_field();
+        auto raw_1 = s.make_raw_field();
+        auto raw_2 = s.make_raw_field();
+        auto field_0 = s.wrap(raw_0);
+        auto field_1 = s.wrap(raw_1);
+        auto field_2 = s.wrap(raw_2);
+        s.fill(field_0, 1);
+        s.fill(field_1, 2);
+        s.fill(field_2, 3);
+        auto h0 = co_0.exchange(pattern(field_0));
+        auto h1 = co_1.exchange(pattern(field_1));
+        auto h2 = co_2.exchange(pattern(field_2));
+        h2.wait();
+        h1.wait();
+        h0.wait();
+        EXPECT_TRUE(s.check(field_0, halos, 1));
+        EXPECT_TRUE(s.check(field_1, halos, 2));
+        EXPECT_TRUE(s.check(field_2, halos, 3));
+
+        // moving keeps the id reserved
+        co_type co_3(std::move(co_2));
+        EXPECT_EQ(co_3.id(), 2);
+        EXPECT_THROW(gridtools::ghex::make_communication_object<decltype(pattern)>(2), std::runtime_error);
+    }
+    // ids are released with their objects
+    auto co_4 = gridtools::ghex::make_communication_object<decltype(pattern)>(gridtools::ghex::auto_id, s.comm);
+    EXPECT_EQ(co_4.id(), 1);
+    EXPECT_EQ(co_0.tag_range(), full_range);
+
+    // id 0 owns the tags below the range of the highest id
+    auto co_max = gridtools::ghex::make_communication_object<decltype(pattern)>(n-1);
+    EXPECT_LE(co_0.tag_offset()+co_0.tag_range(), co_max.tag_offset());
+    EXPECT_GE(co_0.tag_range(), co_max.tag_range());
+
+    // automatic ids agree on all ranks, even if the ranks hold different explicit ids
+    {
+        co_type co_5 = s.comm.rank() == 0 ?
+            gridtools::ghex::make_communication_object<decltype(pattern)>(2) :
+            gridtools::ghex::make_communication_object<decltype(pattern)>();
+        auto co_6 = gridtools::ghex::make_communication_object<decltype(pattern)>(gridtools::ghex::auto_id, s.comm);
+        EXPECT_EQ(co_6.id(), 3);
+    }
+}
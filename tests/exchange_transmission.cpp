@@ -0,0 +1,313 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2019, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include "./exchange_setup.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <vector>
+
+// destinations of the persistent sends which are set up when plans are compiled, recorded through the MPI
+// profiling interface
+static std::vector<int> send_init_dests;
+
+extern "C" int MPI_Send_init(const void* buf, int count, MPI_Datatype type, int dest, int tag, MPI_Comm comm,
+    MPI_Request* request)
+{
+    send_init_dests.push_back(dest);
+    return PMPI_Send_init(buf, count, type, dest, tag, comm, request);
+}
+
+TEST(exchange_transmission, zero_copy)
+{
+    exchange_setup s;
+    // halos only in x, and x is the outermost dimension: the x-faces are contiguous in memory
+    const std::array<int,6> halos{2,2,0,0,0,0};
+    auto pattern = s.make_pattern(halos);
+    auto co = gridtools::ghex::make_communication_object<decltype(pattern)>();
+
+    const std::array<int,3> offsets{2,0,0};
+    const std::array<int,3> extents{s.local_ext[0]+4, s.local_ext[1], s.local_ext[2]};
+    const auto& d = s.local_domains[0];
+    auto make_field = [&](std::vector<int>& raw)
+    {
+        raw.resize(extents[0]*extents[1]*extents[2]);
+        return gridtools::ghex::wrap_field<gridtools::ghex::cpu,0,1,2>(d.domain_id(), raw.data(), offsets, extents);
+    };
+    auto fill = [&](auto& f, int k)
+    {
+        for (int z=0; z<extents[2]; ++z)
+            for (int y=0; y<extents[1]; ++y)
+                for (int x=-2; x<s.local_ext[0]+2; ++x)
+                    f(x,y,z) = (x>=0 && x<s.local_ext[0]) ? exchange_setup::value(d.first()[0]+x, y, z, k) : -1;
+    };
+    auto check = [&](const auto& f, int k)
+    {
+        bool passed = true;
+        for (int z=0; z<extents[2]; ++z)
+            for (int y=0; y<extents[1]; ++y)
+                for (int x=-2; x<s.local_ext[0]+2; ++x)
+                    if (f(x,y,z) != exchange_setup::value((d.first()[0]+x+s.g_last[0]+1)%(s.g_last[0]+1), y, z, k))
+                        passed = false;
+        return passed;
+    };
+
+    std::vector<int> raw_a, raw_b;
+    auto field_a = make_field(raw_a);
+    auto field_b = make_field(raw_b);
+    // the faces are detected as contiguous in this layout, but not in the default one (with less than 3 ranks
+    // both faces are received from the same domain and form a single non-contiguous region)
+    auto field_c = s.wrap(raw_a);
+    for (const auto& h : pattern[0].send_halos())
+    {
+        if (s.comm.size() > 2)
+        {
+            EXPECT_NE(field_a.contiguous_data(h.second), nullptr);
+        }
+        EXPECT_EQ(field_c.contiguous_data(h.second), nullptr);
+    }
+
+    // single field: whole messages are zero-copy; two fields with chunking: every chunk is zero-copy
+    for (std::size_t chunk_size : {std::size_t{0}, std::size_t{1}})
+    {
+        co.set_chunk_size(chunk_size);
+        fill(field_a, 1);
+        co.bexchange(pattern(field_a));
+        EXPECT_TRUE(check(field_a, 1));
+
+        fill(field_a, 2);
+        fill(field_b, 3);
+        co.bexchange(pattern(field_a), pattern(field_b));
+        EXPECT_TRUE(check(field_a, 2));
+        EXPECT_TRUE(check(field_b, 3));
+    }
+
+    auto plan = co.make_plan(pattern(field_a));
+    for (int k=0; k<2; ++k)
+    {
+        fill(field_a, k+4);
+        plan.bexecute();
+        EXPECT_TRUE(check(field_a, k+4));
+    }
+}
+
+TEST(exchange_transmission, datatypes)
+{
+    exchange_setup s;
+    const std::array<int,6> halos1{1,1,1,1,1,1};
+    const std::array<int,6> halos2{2,1,0,2,1,0};
+    auto pattern1 = s.make_pattern(halos1);
+    auto pattern2 = s.make_pattern(halos2);
+    auto co = gridtools::ghex::make_communication_object<decltype(pattern1)>();
+
+    auto raw_a = s.make_raw_field();
+    auto raw_b = s.make_raw_field();
+    auto raw_c = s.make_raw_field();
+    auto field_a = s.wrap(raw_a);
+    auto field_b = s.wrap(raw_b);
+    auto field_c = s.wrap(raw_c);
+
+    // a datatype transmits exactly the bytes of the packed halo region
+    for (const auto& h : pattern1[0].send_halos())
+    {
+        auto type = gridtools::ghex::structured::make_datatype(field_a, h.second);
+        EXPECT_EQ(type.size(), sizeof(int)*decltype(pattern1)::value_type::num_elements(h.second));
+    }
+
+    // packed and typed fields mixed within the same buffers, with and without chunking
+    for (std::size_t chunk_size : {std::size_t{0}, std::size_t{1}})
+    {
+        co.set_chunk_size(chunk_size);
+        s.fill(field_a, 1);
+        s.fill(field_b, 2);
+        s.fill(field_c, 3);
+        co.bexchange(pattern1(field_a), pattern1(field_b).use_datatype(), pattern2(field_c).use_datatype());
+        EXPECT_TRUE(s.check(field_a, halos1, 1));
+        EXPECT_TRUE(s.check(field_b, halos1, 2));
+        EXPECT_TRUE(s.check(field_c, halos2, 3));
+    }
+    co.set_chunk_size(0);
+
+    // vector interface
+    std::vector<decltype(pattern1(field_a))> bis{pattern1(field_a).use_datatype(), pattern1(field_b)};
+    s.fill(field_a, 4);
+    s.fill(field_b, 5);
+    co.exchange(bis.data(), bis.size()).wait();
+    EXPECT_TRUE(s.check(field_a, halos1, 4));
+    EXPECT_TRUE(s.check(field_b, halos1, 5));
+
+    // plans bind the datatypes to persistent requests
+    auto plan = co.make_plan(pattern1(field_a).use_datatype(), pattern2(field_b), pattern1(field_c).use_datatype());
+    for (int k=0; k<2; ++k)
+    {
+        s.fill(field_a, k+6);
+        s.fill(field_b, k+8);
+        s.fill(field_c, k+10);
+        plan.bexecute();
+        EXPECT_TRUE(s.check(field_a, halos1, k+6));
+        EXPECT_TRUE(s.check(field_b, halos2, k+8));
+        EXPECT_TRUE(s.check(field_c, halos1, k+10));
+    }
+}
+
+TEST(exchange_transmission, local_domains)
+{
+    // two domains per rank, stacked in x-direction: halos between them are copied locally
+    exchange_setup s;
+    const std::array<int,3> ext{4, s.local_ext[1], s.local_ext[2]};
+    const std::array<int,3> g_last{2*ext[0]*s.comm.size()-1, ext[1]-1, ext[2]-1};
+    std::vector<domain_descriptor_type> domains;
+    for (int i=0; i<2; ++i)
+    {
+        const int id = 2*s.comm.rank()+i;
+        domains.push_back(domain_descriptor_type{id, 
+            std::array<int,3>{id*ext[0], 0, 0}, std::array<int,3>{(id+1)*ext[0]-1, ext[1]-1, ext[2]-1}});
+    }
+    const std::array<int,6> halos{2,1,1,2,1,0};
+    auto halo_gen = domain_descriptor_type::halo_generator_type(s.g_first, g_last, halos, s.periodic);
+    auto pattern = gridtools::ghex::make_pattern<gridtools::ghex::structured::grid>(s.comm, halo_gen, domains);
+    auto co = gridtools::ghex::make_communication_object<decltype(pattern)>();
+
+    const std::array<int,3> offsets{2,2,2};
+    const std::array<int,3> extents{ext[0]+4, ext[1]+4, ext[2]+4};
+    const std::array<int,3> offsets_b1{3,2,4};
+    const std::array<int,3> extents_b1{ext[0]+5, ext[1]+4, ext[2]+7};
+    std::vector<std::vector<int>> raw(4, std::vector<int>(extents_b1[0]*extents_b1[1]*extents_b1[2]));
+    // field a: contiguous x-faces (copied from / into field memory directly), field b: strided faces with
+    // different memory extents on the two domains (copied element-wise)
+    auto a0 = gridtools::ghex::wrap_field<gridtools::ghex::cpu,0,1,2>(domains[0].domain_id(), raw[0].data(), offsets, extents);
+    auto a1 = gridtools::ghex::wrap_field<gridtools::ghex::cpu,0,1,2>(domains[1].domain_id(), raw[1].data(), offsets, extents);
+    auto b0 = gridtools::ghex::wrap_field<gridtools::ghex::cpu,2,1,0>(domains[0].domain_id(), raw[2].data(), offsets, extents);
+    auto b1 = gridtools::ghex::wrap_field<gridtools::ghex::cpu,2,1,0>(domains[1].domain_id(), raw[3].data(), offsets_b1, extents_b1);
+
+    auto fill = [&](auto& f, const domain_descriptor_type& d, int k)
+    {
+        for (int z=-2; z<ext[2]+2; ++z)
+            for (int y=-2; y<ext[1]+2; ++y)
+                for (int x=-2; x<ext[0]+2; ++x)
+                {
+                    const bool inner = x>=0 && x<ext[0] && y>=0 && y<ext[1] && z>=0 && z<ext[2];
+                    f(x,y,z) = inner ? exchange_setup::value(d.first()[0]+x, y, z, k) : -1;
+                }
+    };
+    auto check = [&](const auto& f, const domain_descriptor_type& d, int k)
+    {
+        bool passed = true;
+        for (int z=-halos[4]; z<ext[2]+halos[5]; ++z)
+            for (int y=-halos[2]; y<ext[1]+halos[3]; ++y)
+                for (int x=-halos[0]; x<ext[0]+halos[1]; ++x)
+                {
+                    const int xg = (d.first()[0]+x + g_last[0]+1)%(g_last[0]+1);
+                    const int yg = (y + g_last[1]+1)%(g_last[1]+1);
+                    const int zg = (z + g_last[2]+1)%(g_last[2]+1);
+                    if (f(x,y,z) != exchange_setup::value(xg,yg,zg,k)) passed = false;
+                }
+        return passed;
+    };
+
+    for (int k=0; k<2; ++k)
+    {
+        fill(a0, domains[0], k);
+        fill(a1, domains[1], k);
+        fill(b0, domains[0], k+2);
+        fill(b1, domains[1], k+2);
+        co.bexchange(pattern(a0), pattern(a1), pattern(b0), pattern(b1));
+        EXPECT_TRUE(check(a0, domains[0], k));
+        EXPECT_TRUE(check(a1, domains[1], k));
+        EXPECT_TRUE(check(b0, domains[0], k+2));
+        EXPECT_TRUE(check(b1, domains[1], k+2));
+    }
+
+    auto plan = co.make_plan(pattern(a0), pattern(a1), pattern(b0), pattern(b1));
+    for (int k=0; k<2; ++k)
+    {
+        fill(a0, domains[0], k+4);
+        fill(a1, domains[1], k+4);
+        fill(b0, domains[0], k+6);
+        fill(b1, domains[1], k+6);
+        plan.bexecute();
+        EXPECT_TRUE(check(a0, domains[0], k+4));
+        EXPECT_TRUE(check(a1, domains[1], k+4));
+        EXPECT_TRUE(check(b0, domains[0], k+6));
+        EXPECT_TRUE(check(b1, domains[1], k+6));
+    }
+}
+
+TEST(exchange_transmission, node_aggregation)
+{
+    exchange_setup s;
+    const std::array<int,6> halos1{1,1,1,1,1,1};
+    const std::array<int,6> halos2{2,1,0,2,1,0};
+    auto pattern1 = s.make_pattern(halos1);
+    auto pattern2 = s.make_pattern(halos2);
+    auto co = gridtools::ghex::make_communication_object<decltype(pattern1)>();
+
+    auto raw_a = s.make_raw_field();
+    auto raw_b = s.make_raw_field();
+    auto field_a = s.wrap(raw_a);
+    auto field_b = s.wrap(raw_b);
+
+    // emulate nodes of two consecutive ranks, such that (with more than 2 ranks) messages to the left neighbor 
+    // or the right neighbor are aggregated
+    MPI_Comm node_comm;
+    MPI_Comm_split(s.mpi_comm, s.comm.rank()/2, s.comm.rank(), &node_comm);
+    for (MPI_Comm c : {node_comm, MPI_Comm{MPI_COMM_NULL}})
+    {
+        co.set_node_aggregation(true, c);
+        EXPECT_TRUE(co.node_aggregation());
+        auto plan = co.make_plan(pattern1(field_a), pattern2(field_b).use_datatype());
+        for (int k=0; k<3; ++k)
+        {
+            s.fill(field_a, k);
+            s.fill(field_b, k+10);
+            auto h = plan.execute();
+            if (k==1)
+                while (!h.test()) {}
+            else
+                h.wait();
+            EXPECT_TRUE(s.check(field_a, halos1, k));
+            EXPECT_TRUE(s.check(field_b, halos2, k+10));
+        }
+    }
+
+    // the messages between two nodes are reduced to one per direction, sent by the node leaders
+    auto num_remote_sends = [&](bool flag)
+    {
+        co.set_node_aggregation(flag, node_comm);
+        send_init_dests.clear();
+        auto plan = co.make_plan(pattern1(field_a), pattern2(field_b));
+        int n = std::count_if(send_init_dests.begin(), send_init_dests.end(),
+            [&s](int dest) { return dest/2 != s.comm.rank()/2; });
+        MPI_Allreduce(MPI_IN_PLACE, &n, 1, MPI_INT, MPI_SUM, s.mpi_comm);
+        s.fill(field_a, 30);
+        s.fill(field_b, 40);
+        plan.bexecute();
+        EXPECT_TRUE(s.check(field_a, halos1, 30));
+        EXPECT_TRUE(s.check(field_b, halos2, 40));
+        return n;
+    };
+    const int num_nodes = (s.comm.size()+1)/2;
+    const int num_aggregated = num_remote_sends(true);
+    const int num_separate = num_remote_sends(false);
+    if (num_nodes > 1)
+    {
+        EXPECT_GT(num_aggregated, 0);
+        EXPECT_LE(num_aggregated, num_nodes*(num_nodes-1));
+        EXPECT_LT(num_aggregated, num_separate);
+    }
+    co.set_node_aggregation(false);
+    EXPECT_FALSE(co.node_aggregation());
+
+    // regular exchanges are not affected
+    s.fill(field_a, 20);
+    co.bexchange(pattern1(field_a));
+    EXPECT_TRUE(s.check(field_a, halos1, 20));
+    MPI_Comm_free(&node_comm);
+}
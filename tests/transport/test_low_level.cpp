@@ -228,6 +228,33 @@ void test1_shared_mesg() {
     }
 }
 
+/**
+ * Persistent requests on two ranks. P0 sends the same buffer repeatedly, P1 receives into the same buffer.
+ */
+void test_persistent() {
+    gridtools::ghex::tl::communicator<gridtools::ghex::tl::mpi_tag> sr;
+
+    std::vector<int> smsg(10);
+    std::vector<int> rmsg(10);
+
+    if ( rank == 0 ) {
+        auto req = sr.send_init(smsg, 1, 1);
+        for (int k = 0; k < 5; ++k) {
+            for (int i = 0; i < 10; ++i) smsg[i] = i+k;
+            sr.start(req).wait();
+        }
+    } else if (rank == 1) {
+        auto req = sr.recv_init(rmsg, 0, 1);
+        for (int k = 0; k < 5; ++k) {
+            sr.start_all(&req, 1);
+            auto fut = req.get_request();
+            while (!fut.test()) {}
+            for (int i = 0; i < 10; ++i) {
+                EXPECT_EQ(rmsg[i], i+k);
+            }
+        }
+    }
+}
 
 template <typename Msg>
 void print_msg(Msg const msg) {
@@ -274,3 +301,9 @@ TEST(transport, basic_shared_msg) {
     test1_shared_mesg();
 }
 
+TEST(transport, basic_persistent) {
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    test_persistent();
+}